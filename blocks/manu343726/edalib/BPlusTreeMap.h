@@ -0,0 +1,648 @@
+/**
+ * @file BPlusTreeMap.h
+ *
+ * A map implemented using a B+ tree. Similar to std::map, but
+ * much friendlier to the CPU cache.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __BPLUSTREEMAP_H
+#define __BPLUSTREEMAP_H
+
+#include "Util.h"
+
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(BPlusTreeMapNoSuchElement)
+DECLARE_EXCEPTION(BPlusTreeMapInvalidAccess)
+
+namespace impl
+{
+    /**
+     * Number of slots of a given size that fit in a node of NodeBytes bytes,
+     * once its header is accounted for. Never less than 4.
+     */
+    template<std::size_t NodeBytes, std::size_t HeaderBytes, std::size_t SlotBytes>
+    struct node_capacity
+    {
+        static const std::size_t value =
+            (NodeBytes > HeaderBytes + 4 * SlotBytes) ? (NodeBytes - HeaderBytes) / SlotBytes : 4;
+    };
+}
+
+/**
+ * A map implemented using a B+ tree. Each node holds many keys, stored
+ * contiguously, so a lookup touches only a few cache lines (or pages) per
+ * level instead of a cache miss per level as in a binary tree. All
+ * entries live in the leaves, which are linked together, so in-order
+ * scans walk arrays instead of chasing pointers.
+ *
+ * Lookups, insertions and removals are O(log N); the tree is always
+ * balanced, and all nodes but the root are at least half full.
+ *
+ * NodeBytes is the target size of each node: use the size of a few
+ * cache lines for in-memory maps, or a page size for huge ones. Keys and
+ * values must be default-constructible and assignable.
+ *
+ * Unlike TreeMap, keys and values are stored apart, so Iterator::elem()
+ * returns entries by value; and any insertion or removal invalidates
+ * all iterators.
+ */
+template <class KeyType, class ValueType, std::size_t NodeBytes = 256>
+class BPlusTreeMap{
+private:
+    typedef std::pair<const KeyType, ValueType> Entry;
+
+    /** common header of leaves and inner nodes */
+    struct Node {
+        bool _leaf;          ///< true for leaves, false for inner nodes
+        std::size_t _count;  ///< number of entries (leaves) or children (inner nodes)
+
+        Node(bool leaf) : _leaf(leaf), _count(0) {}
+    };
+
+    /// maximum number of entries per leaf
+    static const std::size_t LEAF_CAPACITY = impl::node_capacity<
+        NodeBytes, sizeof(Node) + 2 * sizeof(Node*), sizeof(KeyType) + sizeof(ValueType)>::value;
+
+    /// maximum number of children per inner node
+    static const std::size_t INNER_CAPACITY = impl::node_capacity<
+        NodeBytes, sizeof(Node), sizeof(KeyType) + sizeof(Node*)>::value;
+
+    /// minimum number of entries per leaf (except for the root)
+    static const std::size_t LEAF_MIN = LEAF_CAPACITY / 2;
+
+    /// minimum number of children per inner node (except for the root)
+    static const std::size_t INNER_MIN = INNER_CAPACITY / 2;
+
+    /** */
+    struct Leaf : public Node {
+        KeyType _keys[LEAF_CAPACITY];      ///< sorted keys
+        ValueType _values[LEAF_CAPACITY];  ///< _values[i] is the value of _keys[i]
+        Leaf* _prev;  ///< previous leaf in key order, 0 if none
+        Leaf* _next;  ///< next leaf in key order, 0 if none
+
+        Leaf() : Node(true), _prev(0), _next(0) {}
+    };
+
+    /** */
+    struct Inner : public Node {
+        /// sorted keys; _keys[i] is the smallest key reachable from _children[i+1]
+        KeyType _keys[INNER_CAPACITY - 1];
+        Node* _children[INNER_CAPACITY];  ///< subtrees; _count of them are used
+
+        Inner() : Node(false) {}
+    };
+
+    Node* _root;              ///< root of the tree, 0 if empty
+    Leaf* _first;             ///< leftmost leaf, 0 if empty
+    std::size_t _entryCount;  ///< number of key-value entries in tree
+
+public:
+
+    /**  */
+    BPlusTreeMap() : _root(0), _first(0), _entryCount(0) {}
+
+    /**  */
+    BPlusTreeMap(const BPlusTreeMap& other) : _root(0), _first(0), _entryCount(0) {
+        *this = other;
+    }
+
+    /**  */
+    ~BPlusTreeMap() {
+        _delete(_root);
+        _root = 0;
+    }
+
+    /**  */
+    BPlusTreeMap& operator=(const BPlusTreeMap& other) {
+        if (this != &other) {
+            _delete(_root);
+            _first = 0;
+            Leaf *last = 0;
+            _root = _copy(other._root, last);
+            _entryCount = other._entryCount;
+        }
+        return *this;
+    }
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _leaf) {
+                throw BPlusTreeMapInvalidAccess("next");
+            } else if (++_pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+        }
+
+        Entry elem() const {
+            return Entry(key(), value());
+        }
+
+        const ValueType& value() const {
+            return _leaf->_values[_pos];
+        }
+
+        const KeyType& key() const {
+            return _leaf->_keys[_pos];
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _leaf == other._leaf && _pos == other._pos;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return ! (*this == other);
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class BPlusTreeMap;
+
+        Leaf* _leaf;      ///< leaf of the current entry, 0 at the end
+        std::size_t _pos; ///< position of the current entry in its leaf
+
+        /** positions past the end of a leaf are moved to the next leaf */
+        Iterator(Leaf* leaf, std::size_t pos) : _leaf(leaf), _pos(pos) {
+            if (_leaf && _pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+        }
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** */
+    const Iterator find(const KeyType& key) const {
+        Leaf *l = _leafFor(key);
+        if (l) {
+            std::size_t pos = _position(l, key);
+            if (pos < l->_count && l->_keys[pos] == key) {
+                return Iterator(l, pos);
+            }
+        }
+        return end();
+    }
+
+    /**
+     * Returns an iterator to the first entry with a key that is
+     * not less than the given one; handy to start range scans.
+     */
+    Iterator lower_bound(const KeyType& key) const {
+        Leaf *l = _leafFor(key);
+        return l ? Iterator(l, _position(l, key)) : end();
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(_first, 0);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(0, 0);
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        const Iterator it = find(key);
+        if (it == end()) {
+            throw BPlusTreeMapNoSuchElement("at");
+        }
+        return it.value();
+    }
+
+    /** */
+    ValueType& at(const KeyType& key) {
+        NON_CONST_VARIANT(ValueType,BPlusTreeMap,at(key));
+    }
+
+    /** */
+    void insert(const KeyType& key, const ValueType& value) {
+        if ( ! _root) {
+            Leaf *l = new Leaf();
+            l->_keys[0] = key;
+            l->_values[0] = value;
+            l->_count = 1;
+            _root = _first = l;
+            _entryCount ++;
+        } else {
+            KeyType splitKey;
+            Node *split = 0;
+            _insert(_root, key, value, splitKey, split);
+            if (split) {
+                // the root was split: the tree grows one level
+                Inner *root = new Inner();
+                root->_children[0] = _root;
+                root->_children[1] = split;
+                root->_keys[0] = splitKey;
+                root->_count = 2;
+                _root = root;
+            }
+        }
+    }
+
+    /** */
+    void erase(const KeyType& key) {
+        if ( ! _root) {
+            throw BPlusTreeMapNoSuchElement("erase");
+        }
+        _erase(_root, key);
+        _entryCount --;
+        if (_root->_leaf && _root->_count == 0) {
+            delete static_cast<Leaf*>(_root);
+            _root = _first = 0;
+        } else if ( ! _root->_leaf && _root->_count == 1) {
+            // the root has a single child: the tree shrinks one level
+            Inner *old = static_cast<Inner*>(_root);
+            _root = old->_children[0];
+            delete old;
+        }
+    }
+
+    /**
+     * prints one node per line, indented by depth. Leaves are
+     * preceeded by '-', inner nodes by '+'; only keys are printed
+     */
+    void print(std::ostream &out=std::cout) const {
+        _print(_root, 0, out);
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        std::size_t leaves = 0, inners = 0, height = 0;
+        _diagnose(_root, 1, leaves, inners, height);
+        std::size_t bytes = leaves * sizeof(Leaf) + inners * sizeof(Inner);
+        out << "total of " << _entryCount << " entries in " << leaves << " leaves ("
+            << LEAF_CAPACITY << " entries each) and " << inners << " inner nodes ("
+            << INNER_CAPACITY << " children each); height is " << height
+            << " leaf fill is " << (leaves ? 100.0 * _entryCount / (leaves * LEAF_CAPACITY) : 0.0) << "%"
+            << " bytes per entry is " << (_entryCount ? (float)bytes / _entryCount : 0.0f)
+            << std::endl;
+    }
+
+private:
+
+    /** position of the first key in a leaf that is not less than key */
+    static std::size_t _position(const Leaf *l, const KeyType& key) {
+        return std::lower_bound(l->_keys, l->_keys + l->_count, key) - l->_keys;
+    }
+
+    /** index of the child of an inner node that may contain key */
+    static std::size_t _childFor(const Inner *in, const KeyType& key) {
+        return std::upper_bound(in->_keys, in->_keys + in->_count - 1, key) - in->_keys;
+    }
+
+    /** the leaf that contains (or would contain) key, 0 if empty */
+    Leaf *_leafFor(const KeyType& key) const {
+        Node *n = _root;
+        while (n && ! n->_leaf) {
+            Inner *in = static_cast<Inner*>(n);
+            n = in->_children[_childFor(in, key)];
+        }
+        return static_cast<Leaf*>(n);
+    }
+
+    static std::size_t _minCount(const Node *n) {
+        return n->_leaf ? LEAF_MIN : INNER_MIN;
+    }
+
+    /**
+     * Inserts a key-value entry into a subtree, or overwrites the value
+     * if the key was already there.
+     * @param split set to the new right sibling of n if n had to be
+     * split to make room; left untouched otherwise
+     * @param splitKey set to the smallest key under split, if any
+     */
+    void _insert(Node *n, const KeyType& key, const ValueType& value,
+                 KeyType& splitKey, Node*& split) {
+        if (n->_leaf) {
+            _insertInLeaf(static_cast<Leaf*>(n), key, value, splitKey, split);
+        } else {
+            Inner *in = static_cast<Inner*>(n);
+            std::size_t i = _childFor(in, key);
+            KeyType childKey;
+            Node *child = 0;
+            _insert(in->_children[i], key, value, childKey, child);
+            if (child) {
+                _insertChild(in, i + 1, childKey, child, splitKey, split);
+            }
+        }
+    }
+
+    void _insertInLeaf(Leaf *l, const KeyType& key, const ValueType& value,
+                       KeyType& splitKey, Node*& split) {
+        std::size_t pos = _position(l, key);
+        if (pos < l->_count && l->_keys[pos] == key) {
+            l->_values[pos] = value;
+            return;
+        }
+        if (l->_count == LEAF_CAPACITY) {
+            // full; move the upper half to a new leaf
+            Leaf *right = new Leaf();
+            std::size_t half = LEAF_CAPACITY / 2;
+            std::copy(l->_keys + half, l->_keys + LEAF_CAPACITY, right->_keys);
+            std::copy(l->_values + half, l->_values + LEAF_CAPACITY, right->_values);
+            right->_count = LEAF_CAPACITY - half;
+            l->_count = half;
+
+            right->_prev = l;
+            right->_next = l->_next;
+            if (l->_next) {
+                l->_next->_prev = right;
+            }
+            l->_next = right;
+
+            split = right;
+            if (pos > half) {
+                l = right;
+                pos -= half;
+            }
+        }
+        std::copy_backward(l->_keys + pos, l->_keys + l->_count, l->_keys + l->_count + 1);
+        std::copy_backward(l->_values + pos, l->_values + l->_count, l->_values + l->_count + 1);
+        l->_keys[pos] = key;
+        l->_values[pos] = value;
+        l->_count ++;
+        _entryCount ++;
+        if (split) {
+            splitKey = static_cast<Leaf*>(split)->_keys[0];
+        }
+    }
+
+    /**
+     * Inserts a new child at position i of an inner node, splitting the
+     * node if it is full (see _insert).
+     * @param key smallest key under child
+     */
+    void _insertChild(Inner *in, std::size_t i, const KeyType& key, Node *child,
+                      KeyType& splitKey, Node*& split) {
+        if (in->_count < INNER_CAPACITY) {
+            std::copy_backward(in->_keys + i - 1, in->_keys + in->_count - 1, in->_keys + in->_count);
+            std::copy_backward(in->_children + i, in->_children + in->_count, in->_children + in->_count + 1);
+            in->_keys[i - 1] = key;
+            in->_children[i] = child;
+            in->_count ++;
+            return;
+        }
+
+        // full; lay out all keys and children, then move the upper half to a new node
+        KeyType keys[INNER_CAPACITY];
+        Node *children[INNER_CAPACITY + 1];
+        std::copy(in->_keys, in->_keys + i - 1, keys);
+        keys[i - 1] = key;
+        std::copy(in->_keys + i - 1, in->_keys + INNER_CAPACITY - 1, keys + i);
+        std::copy(in->_children, in->_children + i, children);
+        children[i] = child;
+        std::copy(in->_children + i, in->_children + INNER_CAPACITY, children + i + 1);
+
+        Inner *right = new Inner();
+        std::size_t half = (INNER_CAPACITY + 1) / 2;
+        std::copy(children, children + half, in->_children);
+        std::copy(keys, keys + half - 1, in->_keys);
+        in->_count = half;
+        std::copy(children + half, children + INNER_CAPACITY + 1, right->_children);
+        std::copy(keys + half, keys + INNER_CAPACITY, right->_keys);
+        right->_count = INNER_CAPACITY + 1 - half;
+
+        // the key separating both halves moves up
+        splitKey = keys[half - 1];
+        split = right;
+    }
+
+    /**
+     * Erases a key from a subtree. Children left less than half-full
+     * borrow entries from a sibling or are merged with it; n itself may
+     * be left less than half-full (its parent will deal with that).
+     */
+    void _erase(Node *n, const KeyType& key) {
+        if (n->_leaf) {
+            Leaf *l = static_cast<Leaf*>(n);
+            std::size_t pos = _position(l, key);
+            if (pos == l->_count || ! (l->_keys[pos] == key)) {
+                throw BPlusTreeMapNoSuchElement("erase");
+            }
+            std::copy(l->_keys + pos + 1, l->_keys + l->_count, l->_keys + pos);
+            std::copy(l->_values + pos + 1, l->_values + l->_count, l->_values + pos);
+            l->_count --;
+        } else {
+            Inner *in = static_cast<Inner*>(n);
+            std::size_t i = _childFor(in, key);
+            _erase(in->_children[i], key);
+            if (in->_children[i]->_count < _minCount(in->_children[i])) {
+                _refill(in, i);
+            }
+        }
+    }
+
+    /** refills child i of an inner node, which is less than half-full */
+    void _refill(Inner *in, std::size_t i) {
+        Node *left = i > 0 ? in->_children[i - 1] : 0;
+        Node *right = i + 1 < in->_count ? in->_children[i + 1] : 0;
+        if (left && left->_count > _minCount(left)) {
+            _borrowFromLeft(in, i);
+        } else if (right && right->_count > _minCount(right)) {
+            _borrowFromRight(in, i);
+        } else if (left) {
+            _merge(in, i - 1);
+        } else {
+            _merge(in, i);
+        }
+    }
+
+    /** moves the last entry (or child) of child i-1 to the front of child i */
+    static void _borrowFromLeft(Inner *in, std::size_t i) {
+        if (in->_children[i]->_leaf) {
+            Leaf *l = static_cast<Leaf*>(in->_children[i - 1]);
+            Leaf *n = static_cast<Leaf*>(in->_children[i]);
+            std::copy_backward(n->_keys, n->_keys + n->_count, n->_keys + n->_count + 1);
+            std::copy_backward(n->_values, n->_values + n->_count, n->_values + n->_count + 1);
+            n->_keys[0] = l->_keys[l->_count - 1];
+            n->_values[0] = l->_values[l->_count - 1];
+            in->_keys[i - 1] = n->_keys[0];
+            n->_count ++;
+            l->_count --;
+        } else {
+            Inner *l = static_cast<Inner*>(in->_children[i - 1]);
+            Inner *n = static_cast<Inner*>(in->_children[i]);
+            std::copy_backward(n->_keys, n->_keys + n->_count - 1, n->_keys + n->_count);
+            std::copy_backward(n->_children, n->_children + n->_count, n->_children + n->_count + 1);
+            n->_keys[0] = in->_keys[i - 1];
+            n->_children[0] = l->_children[l->_count - 1];
+            in->_keys[i - 1] = l->_keys[l->_count - 2];
+            n->_count ++;
+            l->_count --;
+        }
+    }
+
+    /** moves the first entry (or child) of child i+1 to the back of child i */
+    static void _borrowFromRight(Inner *in, std::size_t i) {
+        if (in->_children[i]->_leaf) {
+            Leaf *n = static_cast<Leaf*>(in->_children[i]);
+            Leaf *r = static_cast<Leaf*>(in->_children[i + 1]);
+            n->_keys[n->_count] = r->_keys[0];
+            n->_values[n->_count] = r->_values[0];
+            std::copy(r->_keys + 1, r->_keys + r->_count, r->_keys);
+            std::copy(r->_values + 1, r->_values + r->_count, r->_values);
+            in->_keys[i] = r->_keys[0];
+            n->_count ++;
+            r->_count --;
+        } else {
+            Inner *n = static_cast<Inner*>(in->_children[i]);
+            Inner *r = static_cast<Inner*>(in->_children[i + 1]);
+            n->_keys[n->_count - 1] = in->_keys[i];
+            n->_children[n->_count] = r->_children[0];
+            in->_keys[i] = r->_keys[0];
+            std::copy(r->_keys + 1, r->_keys + r->_count - 1, r->_keys);
+            std::copy(r->_children + 1, r->_children + r->_count, r->_children);
+            n->_count ++;
+            r->_count --;
+        }
+    }
+
+    /** merges child i+1 into child i, removing it from the inner node */
+    static void _merge(Inner *in, std::size_t i) {
+        if (in->_children[i]->_leaf) {
+            Leaf *n = static_cast<Leaf*>(in->_children[i]);
+            Leaf *r = static_cast<Leaf*>(in->_children[i + 1]);
+            std::copy(r->_keys, r->_keys + r->_count, n->_keys + n->_count);
+            std::copy(r->_values, r->_values + r->_count, n->_values + n->_count);
+            n->_count += r->_count;
+            n->_next = r->_next;
+            if (r->_next) {
+                r->_next->_prev = n;
+            }
+            delete r;
+        } else {
+            Inner *n = static_cast<Inner*>(in->_children[i]);
+            Inner *r = static_cast<Inner*>(in->_children[i + 1]);
+            n->_keys[n->_count - 1] = in->_keys[i];
+            std::copy(r->_keys, r->_keys + r->_count - 1, n->_keys + n->_count);
+            std::copy(r->_children, r->_children + r->_count, n->_children + n->_count);
+            n->_count += r->_count;
+            delete r;
+        }
+        std::copy(in->_keys + i + 1, in->_keys + in->_count - 1, in->_keys + i);
+        std::copy(in->_children + i + 2, in->_children + in->_count, in->_children + i + 1);
+        in->_count --;
+    }
+
+    /**
+     * Deep-copies a subtree, linking its leaves after last
+     * @param last last leaf copied so far; updated during the copy
+     */
+    Node *_copy(const Node *n, Leaf*& last) {
+        if ( ! n) {
+            return 0;
+        } else if (n->_leaf) {
+            const Leaf *l = static_cast<const Leaf*>(n);
+            Leaf *copy = new Leaf();
+            std::copy(l->_keys, l->_keys + l->_count, copy->_keys);
+            std::copy(l->_values, l->_values + l->_count, copy->_values);
+            copy->_count = l->_count;
+            copy->_prev = last;
+            if (last) {
+                last->_next = copy;
+            } else {
+                _first = copy;
+            }
+            last = copy;
+            return copy;
+        } else {
+            const Inner *in = static_cast<const Inner*>(n);
+            Inner *copy = new Inner();
+            std::copy(in->_keys, in->_keys + in->_count - 1, copy->_keys);
+            for (std::size_t i = 0; i < in->_count; i++) {
+                copy->_children[i] = _copy(in->_children[i], last);
+            }
+            copy->_count = in->_count;
+            return copy;
+        }
+    }
+
+    static void _delete(Node *n) {
+        if ( ! n) {
+            return;
+        } else if (n->_leaf) {
+            delete static_cast<Leaf*>(n);
+        } else {
+            Inner *in = static_cast<Inner*>(n);
+            for (std::size_t i = 0; i < in->_count; i++) {
+                _delete(in->_children[i]);
+            }
+            delete in;
+        }
+    }
+
+    static void _print(const Node *n, std::size_t depth, std::ostream &out) {
+        if ( ! n) {
+            return;
+        }
+        out << std::string(3 * depth, ' ');
+        if (n->_leaf) {
+            const Leaf *l = static_cast<const Leaf*>(n);
+            out << "-";
+            for (std::size_t i = 0; i < l->_count; i++) {
+                out << " " << l->_keys[i];
+            }
+            out << std::endl;
+        } else {
+            const Inner *in = static_cast<const Inner*>(n);
+            out << "+";
+            for (std::size_t i = 0; i + 1 < in->_count; i++) {
+                out << " " << in->_keys[i];
+            }
+            out << std::endl;
+            for (std::size_t i = 0; i < in->_count; i++) {
+                _print(in->_children[i], depth + 1, out);
+            }
+        }
+    }
+
+    /**
+     * Counts nodes and measures the height of the tree
+     */
+    static void _diagnose(const Node *n, std::size_t depth, std::size_t &leaves,
+                          std::size_t &inners, std::size_t &height) {
+        if ( ! n) {
+            return;
+        }
+        height = (depth > height) ? depth : height;
+        if (n->_leaf) {
+            leaves ++;
+        } else {
+            inners ++;
+            const Inner *in = static_cast<const Inner*>(n);
+            for (std::size_t i = 0; i < in->_count; i++) {
+                _diagnose(in->_children[i], depth + 1, leaves, inners, height);
+            }
+        }
+    }
+};
+
+/**
+ * A BPlusTreeMap with the default node size. Can be used wherever a
+ * template<typename,typename> associative container is expected (as
+ * in BaseMap and BaseSet).
+ */
+template <class KeyType, class ValueType>
+using DefaultBPlusTreeMap = BPlusTreeMap<KeyType, ValueType>;
+
+#endif // __BPLUSTREEMAP_H
@@ -17,11 +17,16 @@
 
 #include <iomanip>
 #include <iterator>
+#include <future>
+#include <thread>
 
 #include "Util.h"
 #include "Vector.h"
+#include "CVector.h"
 #include "Queue.h"
 
+DECLARE_EXCEPTION(BinTreeInvalidAccess)
+
 /**
  * A binary tree: each node can have left and right children.
  * Binary trees can be used, for example, to implement sorted 
@@ -30,25 +35,40 @@
  * Unlike other modules in this library, this module provides full access 
  * to its internal implementation. To build trees, you *will* have 
  * to access nodes directly. A few utility methods to iterate and 
- * show trees are, however, provided.
+ * show trees are, however, provided; as well as the rotations needed to
+ * keep search trees balanced (see TreeMap). Traversals are lazy: 
+ * preorder(n), inorder(n), postorder(n) and levels(n) return ranges 
+ * that can be walked, and abandoned, one node at a time.
  *
  * @author mfreire
  */
 template <class Type>
 struct BinTree{
-private:
     /** */
     struct Node {
         Type _elem;   ///< actual element stored in node
+        int _height;  ///< height of the subtree rooted here, 1 for leaves; fills the padding after small elements
         Node* _left;  ///< pointer to left child node, 0 if none
         Node* _right; ///< pointer to right child node, 0 if none
+        Node* _parent; ///< pointer to parent node, 0 for roots
+        std::size_t _count; ///< number of nodes in the subtree rooted here
         
         Node(const Type& e, Node *left, Node *right)
-        : _elem(e), _left(left), _right(right) {}
+        : _elem(e), _height(1), _left(0), _right(0), _parent(0), _count(1) {
+            setLeft(this, left);
+            setRight(this, right);
+            update(this);
+        }
     };
     
     Node* _root; ///< root of the tree
     
+    /// deeper subtrees are copied and deleted iteratively
+    static const int MAX_RECURSION_DEPTH = 128;
+    
+    /// subtrees this small are never split between parallel tasks
+    static const std::size_t PARALLEL_GRAIN = 1 << 14;
+    
     /**  */
     BinTree() : _root(0) {}
     
@@ -57,6 +77,11 @@ private:
         _root = copyNode(other._root);
     }
     
+    /**  */
+    BinTree(BinTree&& other) : _root(other._root) {
+        other._root = 0;
+    }
+    
     /**  */
     ~BinTree() {
         deleteNode(_root);
@@ -65,8 +90,17 @@ private:
     
     /**  */
     BinTree& operator=(const BinTree& other) {
-        deleteNode(_root);
-        _root = copyNode(other._root);
+        if (this != &other) {
+            deleteNode(_root);
+            _root = copyNode(other._root);
+        }
+        return *this;
+    }
+    
+    /**  */
+    BinTree& operator=(BinTree&& other) {
+        std::swap(_root, other._root);
+        return *this;
     }
     
     /**  */     
@@ -74,74 +108,657 @@ private:
         return new Node(e, left, right);
     }
     
-    /**  */     
+    /**
+     * Deletes a subtree in O(n) time. Recursion is limited to the first
+     * MAX_RECURSION_DEPTH levels (which balanced trees never exceed), so
+     * deleting degenerate trees cannot overflow the stack.
+     */     
     void deleteNode(Node*& node) {
-        if (node) {
-            deleteNode(node->_left);
-            deleteNode(node->_right);
-            delete node;
-            node = 0;
-        }
+        _deleteNode(node, MAX_RECURSION_DEPTH);
+        node = 0;
     }    
     
-    /**  */     
+    /**
+     * Copies a subtree in O(n) time. As in deleteNode, recursion is
+     * limited to the first MAX_RECURSION_DEPTH levels.
+     */     
     Node* copyNode(Node* n) {
-        if (n) {
-            return createNode(
-                n->_elem, copyNode(n->_left), copyNode(n->_right));
-        } else {
+        return _copyNode(n, MAX_RECURSION_DEPTH);
+    }    
+    
+    /**
+     * Deletes a subtree without recursion. Rotates left children up 
+     * until the node to delete has none, so it runs in O(n) time and 
+     * O(1) space whatever the shape of the tree.
+     */     
+    void deleteNodeIteratively(Node*& node) {
+        Node *n = node;
+        while (n) {
+            if (n->_left) {
+                Node *left = n->_left;
+                n->_left = left->_right;
+                left->_right = n;
+                n = left;
+            } else {
+                Node *right = n->_right;
+                delete n;
+                n = right;
+            }
+        }
+        node = 0;
+    }    
+    
+    /**
+     * Copies a subtree without recursion, in O(n) time and O(1) space. 
+     * Copies are built in pre-order, and climbed back through their 
+     * parent pointers; until its right subtree is copied, the _right 
+     * of each copy points to the node it copies.
+     */     
+    Node* copyNodeIteratively(Node* n) {
+        if ( ! n) {
             return 0;
         }
+        Node *root = createNode(n->_elem);
+        root->_right = n;
+        Node *c = root;
+        for (;;) {
+            Node *original = c->_right;
+            if (original->_left && ! c->_left) {
+                setLeft(c, createNode(original->_left->_elem));
+                c->_left->_right = original->_left;
+                c = c->_left;
+            } else if (original->_right) {
+                setRight(c, createNode(original->_right->_elem));
+                c->_right->_right = original->_right;
+                c = c->_right;
+            } else {
+                // c is complete; climb up to the first copy with its right subtree pending
+                c->_right = 0;
+                update(c);
+                while (c != root && c == c->_parent->_right) {
+                    c = c->_parent;
+                    update(c);
+                }
+                if (c == root) {
+                    return root;
+                }
+                c = c->_parent;
+            }
+        }
     }    
    
-    /**  */ 
-    template <class Collection >
-    void preorder(Collection &accumulator, Node *n) {
-        if (n) {
-            accumulator.push_back(n->_elem);
-            preorder(accumulator, n->_left);
-            preorder(accumulator, n->_right);
+    /**
+     * Builds a perfectly balanced tree from count elements, so that its
+     * in-order traversal yields them in the same order. Reads each
+     * element once, in order, and runs in O(count).
+     * @param first iterator to the first element; advanced past the
+     * last element used
+     * @return root of the new tree
+     */
+    template <class It>
+    Node *buildBalanced(It& first, std::size_t count) {
+        if (count == 0) {
+            return 0;
         }
+        std::size_t leftCount = count / 2;
+        Node *left = buildBalanced(first, leftCount);
+        Node *n = createNode(*first, left);
+        ++ first;
+        setRight(n, buildBalanced(first, count - leftCount - 1));
+        update(n);
+        return n;
     }
     
-    /**  */ 
-    template <class Collection >
-    void inorder(Collection &accumulator, Node *n) {
-        if (n) {
-            inorder(accumulator, n->_left);
-            accumulator.push_back(n->_elem);
-            inorder(accumulator, n->_right);
+    /** pre-order: each node before its left and right subtrees */
+    struct PreOrder {
+        static Node *first(Node *root) {
+            return root;
+        }
+        static Node *next(Node *n, Node *root) {
+            if (n->_left) {
+                return n->_left;
+            } else if (n->_right) {
+                return n->_right;
+            }
+            for (; n != root; n = n->_parent) {
+                if (n == n->_parent->_left && n->_parent->_right) {
+                    return n->_parent->_right;
+                }
+            }
+            return 0;
+        }
+    };
+    
+    /** in-order: each node between its left and right subtrees */
+    struct InOrder {
+        static Node *first(Node *root) {
+            return firstInOrder(root);
+        }
+        static Node *next(Node *n, Node *root) {
+            if (n->_right) {
+                return firstInOrder(n->_right);
+            }
+            while (n != root && n == n->_parent->_right) {
+                n = n->_parent;
+            }
+            return n == root ? 0 : n->_parent;
+        }
+    };
+    
+    /** post-order: each node after its left and right subtrees */
+    struct PostOrder {
+        static Node *first(Node *root) {
+            while (root && (root->_left || root->_right)) {
+                root = root->_left ? root->_left : root->_right;
+            }
+            return root;
+        }
+        static Node *next(Node *n, Node *root) {
+            if (n == root) {
+                return 0;
+            } else if (n == n->_parent->_left && n->_parent->_right) {
+                return first(n->_parent->_right);
+            }
+            return n->_parent;
+        }
+    };
+    
+    /**
+     * Walks a subtree in the given Order (PreOrder, InOrder or PostOrder)
+     * by following parent pointers: O(1) space, and O(1) amortized time
+     * per step. The tree must not change while it is being walked.
+     */
+    template <class Order>
+    class OrderIterator {
+    public:
+        void next() {
+            if ( ! _current) {
+                throw BinTreeInvalidAccess("next");
+            }
+            _current = Order::next(_current, _root);
+        }
+        
+        const Type& elem() const {
+            return _current->_elem;
+        }
+        
+        Type& elem() {
+            return _current->_elem;
         }
+        
+        /** node being visited, 0 at the end */
+        Node *node() const {
+            return _current;
+        }
+        
+        bool operator==(const OrderIterator &other) const {
+            return _current == other._current;
+        }
+        
+        bool operator!=(const OrderIterator &other) const {
+            return _current != other._current;
+        }
+        
+        //Note that an iterator should always be default constructible
+        OrderIterator() : _current(0), _root(0) {}
+        
+    protected:
+        friend struct BinTree;
+        
+        /** current node, 0 at the end */
+        Node* _current;
+        
+        /** root of the subtree being walked; it is never left */
+        Node* _root;
+        
+        OrderIterator(Node *root) : _current(Order::first(root)), _root(root) {}
+    };
+    
+    typedef OrderIterator<PreOrder> PreorderIterator;
+    typedef OrderIterator<InOrder> InorderIterator;
+    typedef OrderIterator<PostOrder> PostorderIterator;
+    
+    /**
+     * Walks a subtree level by level, left to right. Keeps the nodes 
+     * still to visit in a circular buffer, so it needs O(width) space
+     * but no allocations per node; end iterators allocate nothing.
+     */
+    class LevelIterator {
+    public:
+        void next() {
+            if ( ! _current) {
+                throw BinTreeInvalidAccess("next");
+            }
+            if (_current->_left || _current->_right) {
+                if ( ! _pending) {
+                    _pending = new Queue<Node*, CVector>();
+                }
+                if (_current->_left) {
+                    _pending->push(_current->_left);
+                }
+                if (_current->_right) {
+                    _pending->push(_current->_right);
+                }
+            }
+            if (_pending && _pending->size()) {
+                _current = _pending->front();
+                _pending->pop();
+            } else {
+                _current = 0;
+            }
+        }
+        
+        const Type& elem() const {
+            return _current->_elem;
+        }
+        
+        Type& elem() {
+            return _current->_elem;
+        }
+        
+        /** node being visited, 0 at the end */
+        Node *node() const {
+            return _current;
+        }
+        
+        bool operator==(const LevelIterator &other) const {
+            return _current == other._current;
+        }
+        
+        bool operator!=(const LevelIterator &other) const {
+            return _current != other._current;
+        }
+        
+        //Note that an iterator should always be default constructible
+        LevelIterator() : _current(0), _pending(0) {}
+        
+        LevelIterator(const LevelIterator& other) : _current(other._current), 
+            _pending(other._pending ? new Queue<Node*, CVector>(*other._pending) : 0) {}
+        
+        LevelIterator(LevelIterator&& other) : _current(other._current), _pending(other._pending) {
+            other._pending = 0;
+        }
+        
+        LevelIterator& operator=(LevelIterator other) {
+            std::swap(_current, other._current);
+            std::swap(_pending, other._pending);
+            return *this;
+        }
+        
+        ~LevelIterator() {
+            delete _pending;
+        }
+        
+    protected:
+        friend struct BinTree;
+        
+        /** current node, 0 at the end */
+        Node* _current;
+        
+        /** nodes still to visit, in order; 0 until first needed */
+        Queue<Node*, CVector>* _pending;
+        
+        LevelIterator(Node *root) : _current(root), _pending(0) {}
+    };
+    
+    /** A sequence of nodes, as returned by preorder(n) and friends */
+    template <class It>
+    class Range {
+    public:
+        It begin() const {
+            return _begin;
+        }
+        
+        It end() const {
+            return It();
+        }
+        
+    protected:
+        friend struct BinTree;
+        
+        It _begin;
+        
+        Range(const It& begin) : _begin(begin) {}
+    };
+    
+    /** lazily walks the subtree rooted at n in pre-order */
+    Range<PreorderIterator> preorder(Node *n) const {
+        return Range<PreorderIterator>(PreorderIterator(n));
     }
     
-    /**  */
+    /** lazily walks the subtree rooted at n in in-order */
+    Range<InorderIterator> inorder(Node *n) const {
+        return Range<InorderIterator>(InorderIterator(n));
+    }
+    
+    /** lazily walks the subtree rooted at n in post-order */
+    Range<PostorderIterator> postorder(Node *n) const {
+        return Range<PostorderIterator>(PostorderIterator(n));
+    }
+    
+    /** lazily walks the subtree rooted at n level by level */
+    Range<LevelIterator> levels(Node *n) const {
+        return Range<LevelIterator>(LevelIterator(n));
+    }
+    
+    /** appends the subtree rooted at n, in pre-order, to accumulator */ 
     template <class Collection >
-    void postorder(Collection &accumulator, Node *n) {
-        if (n) {
-            postorder(accumulator, n->_left);
-            postorder(accumulator, n->_right);
-            accumulator.push_back(n->_elem);
-        }
+    void preorder(Collection &accumulator, Node *n) const {
+        _accumulate(accumulator, preorder(n));
     }
     
-    /**  */
+    /** appends the subtree rooted at n, in in-order, to accumulator */ 
     template <class Collection >
-    void levels(Collection &accumulator, Node *n) {
-        if (n) {
-            Queue<Node *> q;
-            q.push(n);
-            while (q.size()) {
-                Node *current = q.top();
-                accumulator.push_back(current->_elem);
-                q.pop();
-                if (current->_left) {
-                    q.push(current->_left);
+    void inorder(Collection &accumulator, Node *n) const {
+        _accumulate(accumulator, inorder(n));
+    }
+    
+    /** appends the subtree rooted at n, in post-order, to accumulator */ 
+    template <class Collection >
+    void postorder(Collection &accumulator, Node *n) const {
+        _accumulate(accumulator, postorder(n));
+    }
+    
+    /** appends the subtree rooted at n, level by level, to accumulator */ 
+    template <class Collection >
+    void levels(Collection &accumulator, Node *n) const {
+        _accumulate(accumulator, levels(n));
+    }
+    
+    /**
+     * Visits a subtree in in-order using Morris' algorithm, which needs
+     * neither parent pointers nor a stack: O(1) space. It threads the 
+     * right pointer of each in-order predecessor to its successor while
+     * walking, and removes the thread when following it, so the tree is
+     * only intact again once it returns; visit must not look at the tree.
+     * @param visit called with each element; returns false to stop 
+     * visiting (the walk still finishes, to restore the tree)
+     * @return false if visit stopped the traversal
+     */
+    template <class Visitor>
+    static bool morrisInorder(Node *n, Visitor visit) {
+        bool visiting = true;
+        while (n) {
+            if (n->_left) {
+                Node *pred = n->_left;
+                while (pred->_right && pred->_right != n) {
+                    pred = pred->_right;
                 }
-                if (current->_right) {
-                    q.push(current->_right);
+                if ( ! pred->_right) {
+                    // first time here: thread the predecessor back to n
+                    pred->_right = n;
+                    n = n->_left;
+                    continue;
                 }
+                // back through the thread: left subtree done
+                pred->_right = 0;
+            }
+            visiting = visiting && visit(n->_elem);
+            n = n->_right;
+        }
+        return visiting;
+    }
+
+    /** threads the hardware can run at once; 1 if unknown */
+    static unsigned hardwareThreads() {
+        unsigned threads = std::thread::hardware_concurrency();
+        return threads ? threads : 1;
+    }
+
+    /**
+     * Maps each element of a subtree and combines the results in 
+     * in-order, forking a task for the left subtree of each node while
+     * there are threads to spare, and the subtree is larger than grain 
+     * and has both children. Smaller subtrees are reduced sequentially. 
+     * combine must be associative, and the tree must not change meanwhile.
+     * @param map called with each element; may run in any thread
+     * @param combine called with two partial results
+     * @param threads maximum number of threads to use (including 
+     * the calling one)
+     * @param grain subtrees with this many nodes or less are not split
+     * @return the combined result; a default-constructed one for empty subtrees
+     */
+    template <class Map, class Combine>
+    static auto parallel_reduce(Node *n, Map map, Combine combine, 
+            unsigned threads = hardwareThreads(), std::size_t grain = PARALLEL_GRAIN)
+            -> decltype(map(n->_elem)) {
+        typedef decltype(map(n->_elem)) Result;
+        if ( ! n) {
+            return Result();
+        } else if (threads < 2 || n->_count <= grain || ! n->_left || ! n->_right) {
+            InorderIterator it(n);
+            Result result = map(it.elem());
+            for (it.next(); it != InorderIterator(); it.next()) {
+                result = combine(result, map(it.elem()));
+            }
+            return result;
+        }
+        std::future<Result> left = std::async(std::launch::async, [&]() {
+            return parallel_reduce(n->_left, map, combine, threads / 2, grain);
+        });
+        Result right = parallel_reduce(n->_right, map, combine, threads - threads / 2, grain);
+        return combine(combine(left.get(), map(n->_elem)), right);
+    }
+    
+    /**
+     * Calls f with each element of a subtree, in no particular order, 
+     * splitting the subtree between threads as parallel_reduce does.
+     * The shape of the tree must not change meanwhile.
+     */
+    template <class F>
+    static void parallel_for_each(Node *n, F f, 
+            unsigned threads = hardwareThreads(), std::size_t grain = PARALLEL_GRAIN) {
+        if ( ! n) {
+            return;
+        } else if (threads < 2 || n->_count <= grain || ! n->_left || ! n->_right) {
+            for (PreorderIterator it(n); it != PreorderIterator(); it.next()) {
+                f(it.elem());
+            }
+            return;
+        }
+        std::future<void> left = std::async(std::launch::async, [&]() {
+            parallel_for_each(n->_left, f, threads / 2, grain);
+        });
+        parallel_for_each(n->_right, f, threads - threads / 2, grain);
+        f(n->_elem);
+        left.get();
+    }
+
+    /** makes child (which may be 0) the left child of n */
+    static void setLeft(Node *n, Node *child) {
+        n->_left = child;
+        if (child) {
+            child->_parent = n;
+        }
+    }
+    
+    /** makes child (which may be 0) the right child of n */
+    static void setRight(Node *n, Node *child) {
+        n->_right = child;
+        if (child) {
+            child->_parent = n;
+        }
+    }
+    
+    /** first node of a subtree in in-order; 0 if empty */
+    static Node *firstInOrder(Node *n) {
+        if (n) {
+            while (n->_left) {
+                n = n->_left;
+            }
+        }
+        return n;
+    }
+    
+    /** last node of a subtree in in-order; 0 if empty */
+    static Node *lastInOrder(Node *n) {
+        if (n) {
+            while (n->_right) {
+                n = n->_right;
+            }
+        }
+        return n;
+    }
+    
+    /**
+     * next node in in-order, 0 if none. Follows parent pointers, so 
+     * walking a whole tree with it visits each edge twice: O(1) amortized.
+     */
+    static Node *nextInOrder(Node *n) {
+        if (n->_right) {
+            return firstInOrder(n->_right);
+        }
+        while (n->_parent && n == n->_parent->_right) {
+            n = n->_parent;
+        }
+        return n->_parent;
+    }
+    
+    /** previous node in in-order, 0 if none. Mirror image of nextInOrder */
+    static Node *prevInOrder(Node *n) {
+        if (n->_left) {
+            return lastInOrder(n->_left);
+        }
+        while (n->_parent && n == n->_parent->_left) {
+            n = n->_parent;
+        }
+        return n->_parent;
+    }
+    
+    /** height of a subtree; 0 for empty subtrees */
+    static int height(Node *n) {
+        return n ? n->_height : 0;
+    }
+    
+    /** number of nodes in a subtree; 0 for empty subtrees */
+    static std::size_t count(Node *n) {
+        return n ? n->_count : 0;
+    }
+    
+    /** difference between the left and right heights of a subtree */
+    static int balanceFactor(Node *n) {
+        return n ? height(n->_left) - height(n->_right) : 0;
+    }
+    
+    /**
+     * Recomputes the bookkeeping of a node from that of its children.
+     * Must be called, bottom-up, whenever the children of a node change.
+     */
+    static void update(Node *n) {
+        int l = height(n->_left), r = height(n->_right);
+        n->_height = 1 + (l > r ? l : r);
+        n->_count = 1 + count(n->_left) + count(n->_right);
+    }
+    
+    /**
+     * Rotates a subtree to the left; its right child becomes its root,
+     * and inherits its parent (whose child pointer must then be updated).
+     * <pre>
+     *     n              r
+     *    / \            / \
+     *   a   r    =>    n   c
+     *      / \        / \
+     *     b   c      a   b
+     * </pre>
+     * @return the new root of the subtree
+     */
+    static Node *rotateLeft(Node *n) {
+        Node *r = n->_right;
+        r->_parent = n->_parent;
+        setRight(n, r->_left);
+        setLeft(r, n);
+        update(n);
+        update(r);
+        return r;
+    }
+    
+    /**
+     * Rotates a subtree to the right; its left child becomes its root.
+     * Mirror image of rotateLeft.
+     * @return the new root of the subtree
+     */
+    static Node *rotateRight(Node *n) {
+        Node *l = n->_left;
+        l->_parent = n->_parent;
+        setLeft(n, l->_right);
+        setRight(l, n);
+        update(n);
+        update(l);
+        return l;
+    }
+    
+    /**
+     * Restores the AVL property (children heights differ in at most 1)
+     * of a subtree whose children are AVL trees with heights that differ
+     * in at most 2, as happens after a single insertion or removal.
+     * @return the new root of the subtree
+     */
+    static Node *rebalance(Node *n) {
+        update(n);
+        int balance = balanceFactor(n);
+        if (balance > 1) {
+            if (balanceFactor(n->_left) < 0) {
+                setLeft(n, rotateLeft(n->_left));
+            }
+            return rotateRight(n);
+        } else if (balance < -1) {
+            if (balanceFactor(n->_right) > 0) {
+                setRight(n, rotateRight(n->_right));
             }
+            return rotateLeft(n);
         }
+        return n;
+    }
+
+    /**
+     * Joins two AVL subtrees and a node that goes between them (in 
+     * in-order: after every node of left, before every node of right) 
+     * into a single AVL tree. Walks down the taller subtree until it 
+     * reaches the height of the other, so it takes 
+     * O(|height(left) - height(right)| + 1) time.
+     * @param n node to join with; its former children are ignored
+     * @return the root of the joined tree, with no valid parent
+     */
+    static Node *join(Node *left, Node *n, Node *right) {
+        if (height(left) > height(right) + 1) {
+            setRight(left, join(left->_right, n, right));
+            return rebalance(left);
+        } else if (height(right) > height(left) + 1) {
+            setLeft(right, join(left, n, right->_left));
+            return rebalance(right);
+        }
+        setLeft(n, left);
+        setRight(n, right);
+        update(n);
+        return n;
+    }
+    
+    /**
+     * Joins two AVL subtrees, every node of left going before every
+     * node of right in in-order. O(height(left) + height(right))
+     * @return the root of the joined tree, with no valid parent
+     */
+    static Node *join(Node *left, Node *right) {
+        if ( ! left) {
+            return right;
+        }
+        Node *last;
+        left = detachLast(left, last);
+        return join(left, last, right);
+    }
+    
+    /**
+     * Disconnects the last node, in in-order, of a (non-empty) AVL subtree.
+     * @param last set to the disconnected node
+     * @return the new root of the subtree, rebalanced
+     */
+    static Node *detachLast(Node *n, Node *&last) {
+        if ( ! n->_right) {
+            last = n;
+            return n->_left;
+        }
+        setRight(n, detachLast(n->_right, last));
+        return rebalance(n);
     }
 
     /**
@@ -169,6 +786,36 @@ private:
     
 private:
     
+    template <class Collection, class R>
+    static void _accumulate(Collection &accumulator, const R& range) {
+        for (auto it = range.begin(); it != range.end(); it.next()) {
+            accumulator.push_back(it.elem());
+        }
+    }
+    
+    void _deleteNode(Node *n, int depthLeft) {
+        if ( ! n) {
+            return;
+        } else if (depthLeft == 0) {
+            deleteNodeIteratively(n);
+        } else {
+            _deleteNode(n->_left, depthLeft - 1);
+            _deleteNode(n->_right, depthLeft - 1);
+            delete n;
+        }
+    }
+    
+    Node* _copyNode(Node *n, int depthLeft) {
+        if ( ! n) {
+            return 0;
+        } else if (depthLeft == 0) {
+            return copyNodeIteratively(n);
+        } else {
+            return createNode(n->_elem, 
+                _copyNode(n->_left, depthLeft - 1), _copyNode(n->_right, depthLeft - 1));
+        }
+    }
+    
     void _print(Node *n, Vector<char>& bars, char nodeChar,
                std::ostream &out) const {
         if (n) {
@@ -0,0 +1,131 @@
+/**
+ * @file BloomFilter.h
+ *
+ * A blocked Bloom filter: a compact, probabilistic set of hashes that
+ * tells, from a single cache line, that a key is definitely not there
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __BLOOMFILTER_H
+#define __BLOOMFILTER_H
+
+#include "Util.h"
+
+#include <cstdint>
+
+/**
+ * A split block Bloom filter of 64-bit hashes. The filter is an array of
+ * 64-byte blocks, aligned to cache lines; each hash picks a block, and
+ * sets (or checks) one bit in each of its 8 words. A query thus reads a
+ * single cache line, with no data-dependent branches.
+ *
+ * There are no false negatives. With 10 bits per key, about 1% of the
+ * hashes that were never added are reported as (maybe) there. Hashes
+ * cannot be removed; rebuild the filter instead.
+ */
+class BlockedBloomFilter{
+public:
+    /// 64-bit words per block; a block fills a cache line
+    static const std::size_t WORDS = 8;
+
+    /** a filter for up to the given number of keys */
+    explicit BlockedBloomFilter(std::size_t keys, std::size_t bitsPerKey = 10)
+        : _blockCount((keys * bitsPerKey + 511) / 512) {
+        if (_blockCount == 0) {
+            _blockCount = 1;
+        }
+        _allocate();
+    }
+
+    /**  */
+    BlockedBloomFilter(const BlockedBloomFilter& other) : _blockCount(other._blockCount) {
+        _allocate();
+        std::copy(other._words, other._words + _blockCount * WORDS, _words);
+    }
+
+    /**  */
+    ~BlockedBloomFilter() {
+        delete[] _memory;
+    }
+
+    BlockedBloomFilter& operator=(const BlockedBloomFilter&) = delete;
+
+    /** adds a hash */
+    void add(std::size_t hash) {
+        uint64_t mixed = _mix(hash);
+        uint64_t *block = _blockFor(mixed);
+        uint32_t h = (uint32_t)mixed;
+        for (std::size_t i=0; i<WORDS; i++) {
+            block[i] |= _bit(h, i);
+        }
+    }
+
+    /** false if the hash was definitely never added */
+    bool mayContain(std::size_t hash) const {
+        uint64_t mixed = _mix(hash);
+        const uint64_t *block = _blockFor(mixed);
+        uint32_t h = (uint32_t)mixed;
+        uint64_t missing = 0;
+        for (std::size_t i=0; i<WORDS; i++) {
+            missing |= _bit(h, i) & ~block[i];
+        }
+        return missing == 0;
+    }
+
+    /** removes every hash */
+    void clear() {
+        std::fill(_words, _words + _blockCount * WORDS, 0);
+    }
+
+    /** size of the bit array */
+    std::size_t bytes() const {
+        return _blockCount * WORDS * sizeof(uint64_t);
+    }
+
+private:
+    std::size_t _blockCount; ///< number of 64-byte blocks
+    uint64_t *_memory;       ///< allocated words, including those skipped to align
+    uint64_t *_words;        ///< first word of the first block
+
+    void _allocate() {
+        _memory = new uint64_t[_blockCount * WORDS + WORDS - 1]();
+        std::size_t misalignment = ((std::size_t)_memory / sizeof(uint64_t)) % WORDS;
+        _words = _memory + (misalignment ? WORDS - misalignment : 0);
+    }
+
+    /**
+     * spreads every bit of a hash over both halves, which pick the block
+     * and the bits in it (as the finalizer of MurmurHash3)
+     */
+    static uint64_t _mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /** the block of a mixed hash, chosen by its upper half */
+    uint64_t *_blockFor(uint64_t hash) const {
+        uint64_t upper = hash >> 32;
+        return _words + ((upper * _blockCount) >> 32) * WORDS;
+    }
+
+    /** the bit of a hash in the i-th word of its block, chosen by its lower half */
+    static uint64_t _bit(uint32_t h, std::size_t i) {
+        // odd multipliers, one per word (as in Parquet's split block filters)
+        static const uint32_t SALT[WORDS] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+        };
+        return (uint64_t)1 << ((h * SALT[i]) >> 26);
+    }
+};
+
+#endif // __BLOOMFILTER_H
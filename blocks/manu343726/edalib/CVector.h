@@ -46,7 +46,7 @@ private:
 public:
     
     /**  */
-    CVector(bool prealloc = true) : _start(0), _end(0), _used(0), _max(INITIAL_SIZE) , _v{nullptr} //Never leave a member uninitialized. If something on the constructor fails could be a problem
+    CVector(bool prealloc = true) : _v{nullptr}, _start(0), _end(0), _used(0), _max(INITIAL_SIZE) //Never leave a member uninitialized. If something on the constructor fails could be a problem
     {
         _v = prealloc ? new Type[_max] : nullptr;
     }
@@ -87,7 +87,7 @@ public:
 
     /**  */
     CVector& operator=(const CVector& other) {
-        delete _v;
+        delete[] _v;
         _max = other._max;
         _v = new Type[_max];
         _used = other.size();
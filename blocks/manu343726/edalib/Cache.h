@@ -0,0 +1,481 @@
+/**
+ * @file Cache.h
+ *
+ * A bounded key-value cache that evicts entries by recency (LRU),
+ * frequency (LFU) or second chance (CLOCK)
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include "Util.h"
+#include "HashTable.h" // hash functions
+
+DECLARE_EXCEPTION(CacheOverweight)
+
+/**
+ * Links of an intrusive, circular, doubly-linked list. A list is a
+ * sentinel CacheLinks, linked to itself when empty; its elements
+ * derive from CacheLinks, so linking and unlinking them never allocates.
+ */
+struct CacheLinks {
+    CacheLinks* _prev;
+    CacheLinks* _next;
+
+    CacheLinks() : _prev(this), _next(this) {}
+
+    bool empty() const {
+        return _next == this;
+    }
+
+    /** links this (unlinked) element right after another */
+    void linkAfter(CacheLinks *other) {
+        _prev = other;
+        _next = other->_next;
+        _next->_prev = this;
+        other->_next = this;
+    }
+
+    void unlink() {
+        _prev->_next = _next;
+        _next->_prev = _prev;
+        _prev = _next = this;
+    }
+};
+
+/**
+ * Evicts the least recently used entry. Entries are kept in a list, most
+ * recently used first; a hit moves its entry to the front
+ */
+struct LRUPolicy {
+    struct State {};
+
+    template <class Node>
+    class Order {
+        CacheLinks _list; ///< most recently used first
+
+    public:
+        void added(Node *n) {
+            n->linkAfter(&_list);
+        }
+
+        void touched(Node *n) {
+            n->unlink();
+            n->linkAfter(&_list);
+        }
+
+        void removed(Node *n) {
+            n->unlink();
+        }
+
+        /** the entry to evict, other than keep (there must be one) */
+        Node *victim(const Node *keep) {
+            CacheLinks *last = _list._prev;
+            return static_cast<Node*>(last == keep ? last->_prev : last);
+        }
+    };
+};
+
+/**
+ * Evicts the least frequently used entry; the least recently used one
+ * among those with as few hits. Entries are kept in buckets, one per hit
+ * count, which are in turn kept in a list sorted by hit count: a hit
+ * moves its entry to the next bucket, creating it if needed, so all
+ * operations are O(1). Emptied buckets are kept for reuse; once there
+ * are as many as needed, hits no longer allocate.
+ */
+struct LFUPolicy {
+    /** the entries with a given number of hits, most recently used first */
+    struct Bucket : CacheLinks {
+        std::size_t _hits;
+        CacheLinks _entries;
+    };
+
+    typedef Bucket* State; ///< bucket of each entry
+
+    template <class Node>
+    class Order {
+        CacheLinks _buckets; ///< buckets in use, fewest hits first
+        CacheLinks _spare;   ///< emptied buckets, for reuse
+
+    public:
+        Order() = default;
+
+        Order(const Order&) = delete;
+
+        ~Order() {
+            for (CacheLinks *list : { &_buckets, &_spare }) {
+                while ( ! list->empty()) {
+                    Bucket *b = static_cast<Bucket*>(list->_next);
+                    b->unlink();
+                    delete b;
+                }
+            }
+        }
+
+        void added(Node *n) {
+            CacheLinks *first = _buckets._next;
+            _enter(n, first != &_buckets && static_cast<Bucket*>(first)->_hits == 0 ?
+                static_cast<Bucket*>(first) : _bucketAfter(&_buckets, 0));
+        }
+
+        void touched(Node *n) {
+            Bucket *b = n->_state;
+            CacheLinks *next = b->_next;
+            Bucket *target = next != &_buckets && static_cast<Bucket*>(next)->_hits == b->_hits + 1 ?
+                static_cast<Bucket*>(next) : _bucketAfter(b, b->_hits + 1);
+            removed(n);
+            _enter(n, target);
+        }
+
+        void removed(Node *n) {
+            Bucket *b = n->_state;
+            n->unlink();
+            if (b->_entries.empty()) {
+                b->unlink();
+                b->linkAfter(&_spare);
+            }
+        }
+
+        /** as LRUPolicy::Order::victim */
+        Node *victim(const Node *keep) {
+            Bucket *b = static_cast<Bucket*>(_buckets._next);
+            CacheLinks *last = b->_entries._prev;
+            if (last != keep) {
+                return static_cast<Node*>(last);
+            } else if (last->_prev != &b->_entries) {
+                return static_cast<Node*>(last->_prev);
+            }
+            return static_cast<Node*>(static_cast<Bucket*>(b->_next)->_entries._prev);
+        }
+
+    private:
+        static void _enter(Node *n, Bucket *b) {
+            n->linkAfter(&b->_entries);
+            n->_state = b;
+        }
+
+        /** a new (or reused) bucket, linked after another */
+        Bucket *_bucketAfter(CacheLinks *previous, std::size_t hits) {
+            Bucket *b;
+            if (_spare.empty()) {
+                b = new Bucket();
+            } else {
+                b = static_cast<Bucket*>(_spare._next);
+                b->unlink();
+            }
+            b->_hits = hits;
+            b->linkAfter(previous);
+            return b;
+        }
+    };
+};
+
+/**
+ * Approximates LRU with a single bit per entry: a hit only sets the bit.
+ * Entries are kept in a circle swept by a clock hand; the hand clears
+ * the bits it finds set (a second chance), and evicts the first entry
+ * whose bit was already clear. Hits do not reorder anything, which makes
+ * them the cheapest of the three policies
+ */
+struct ClockPolicy {
+    typedef bool State; ///< hit since the hand last passed
+
+    template <class Node>
+    class Order {
+        CacheLinks _circle; ///< entries, in sweep order from the hand
+        CacheLinks *_hand;  ///< next entry to look at; the sentinel is skipped
+
+    public:
+        Order() : _hand(&_circle) {}
+
+        Order(const Order&) = delete;
+
+        /** new entries go right behind the hand, so they are swept last */
+        void added(Node *n) {
+            n->linkAfter(_hand->_prev);
+            n->_state = false;
+        }
+
+        void touched(Node *n) {
+            n->_state = true;
+        }
+
+        void removed(Node *n) {
+            if (_hand == n) {
+                _hand = n->_next;
+            }
+            n->unlink();
+        }
+
+        /** as LRUPolicy::Order::victim */
+        Node *victim(const Node *keep) {
+            for (;; _hand = _hand->_next) {
+                if (_hand != &_circle && _hand != keep) {
+                    Node *n = static_cast<Node*>(_hand);
+                    if ( ! n->_state) {
+                        return n;
+                    }
+                    n->_state = false;
+                }
+            }
+        }
+    };
+};
+
+/**
+ * A key-value cache that holds entries up to a total weight (by default,
+ * each entry weighs 1, so that the capacity is a number of entries),
+ * evicting them as the Policy says: LRUPolicy, LFUPolicy or ClockPolicy.
+ *
+ * Entries are nodes of an intrusive hash table, and of the eviction
+ * order of the policy, at once. A hit is a single hash lookup and a
+ * few pointer updates, with no allocation; a miss that evicts an entry
+ * reuses its node. get, put and erase are O(1) on average.
+ */
+template <class KeyType, class ValueType, class Policy = LRUPolicy>
+class Cache{
+private:
+    /** an entry: a link in the eviction order and in a hash chain */
+    struct Node : CacheLinks {
+        KeyType _key;
+        ValueType _value;
+        std::size_t _weight;
+        Node* _chain;  ///< next node in the same hash bucket, 0 if none
+        typename Policy::State _state;
+
+        Node(const KeyType& key, const ValueType& value, std::size_t weight)
+            : _key(key), _value(value), _weight(weight), _chain(0) {}
+    };
+
+    typedef typename Policy::template Order<Node> Order;
+
+    /** initial number of hash buckets */
+    static const std::size_t INITIAL_SIZE = 16;
+
+    std::size_t _capacity;     ///< largest total weight
+    std::size_t _weight;       ///< total weight of the entries
+    std::size_t _entryCount;   ///< number of entries
+    Node** _buckets;           ///< hash chains; a power of two of them
+    std::size_t _size;         ///< current number of buckets
+    Node* _spare;              ///< last evicted node, for reuse; 0 if none
+    std::size_t _hits;         ///< gets that found their key
+    std::size_t _misses;       ///< gets that did not
+    Order _order;              ///< eviction order
+
+public:
+
+    /** a cache for entries up to a total weight */
+    explicit Cache(std::size_t capacity)
+        : _capacity(capacity), _weight(0), _entryCount(0),
+          _size(INITIAL_SIZE), _spare(0), _hits(0), _misses(0) {
+        _buckets = new Node*[_size]();
+    }
+
+    Cache(const Cache&) = delete;
+
+    Cache& operator=(const Cache&) = delete;
+
+    /**  */
+    ~Cache() {
+        for (std::size_t i=0; i<_size; i++) {
+            while (_buckets[i]) {
+                Node *n = _buckets[i];
+                _buckets[i] = n->_chain;
+                delete n;
+            }
+        }
+        delete[] _buckets;
+        delete _spare;
+    }
+
+    /** number of entries */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    /** total weight of the entries */
+    std::size_t weight() const {
+        return _weight;
+    }
+
+    /** largest total weight */
+    std::size_t capacity() const {
+        return _capacity;
+    }
+
+    /**
+     * Looks up a key, counting a hit (or a miss) for the policy
+     * @return the cached value, which can be changed in place; 0 if none
+     */
+    ValueType* get(const KeyType& key) {
+        Node *n = *_chainFor(key);
+        if ( ! n) {
+            _misses ++;
+            return 0;
+        }
+        _hits ++;
+        _order.touched(n);
+        return &n->_value;
+    }
+
+    /** true if the key is cached; neither a hit nor a miss */
+    bool contains(const KeyType& key) const {
+        return *_chainFor(key) != 0;
+    }
+
+    /**
+     * Caches a value, replacing (and counting a hit on) any already
+     * cached for the key. Evicts entries as needed to stay within
+     * capacity; throws CacheOverweight if the entry alone exceeds it
+     */
+    void put(const KeyType& key, const ValueType& value, std::size_t weight = 1) {
+        if (weight > _capacity) {
+            throw CacheOverweight("put");
+        }
+        Node **chain = _chainFor(key);
+        Node *n = *chain;
+        if (n) {
+            _weight -= n->_weight;
+            n->_value = value;
+            n->_weight = weight;
+            _order.touched(n);
+        }
+        while (_weight + weight > _capacity) {
+            _evict(n);
+            chain = 0; // evictions may change the chain
+        }
+        if (n) {
+            _weight += weight;
+            return;
+        }
+        if (_spare) {
+            n = _spare;
+            _spare = 0;
+            n->_key = key;
+            n->_value = value;
+            n->_weight = weight;
+        } else {
+            n = new Node(key, value, weight);
+        }
+        if (_entryCount >= _size) {
+            _grow();
+            chain = 0;
+        }
+        if ( ! chain) {
+            chain = _chainFor(key);
+        }
+        n->_chain = 0;
+        *chain = n;
+        _order.added(n);
+        _weight += weight;
+        _entryCount ++;
+    }
+
+    /**
+     * Removes a key from the cache
+     * @return true if it was cached
+     */
+    bool erase(const KeyType& key) {
+        Node **chain = _chainFor(key);
+        Node *n = *chain;
+        if ( ! n) {
+            return false;
+        }
+        _order.removed(n);
+        _unchain(chain, n);
+        _recycle(n);
+        return true;
+    }
+
+    /** gets that found their key, since the cache was built */
+    std::size_t hits() const {
+        return _hits;
+    }
+
+    /** gets that did not find their key */
+    std::size_t misses() const {
+        return _misses;
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        out << "total of " << _entryCount << " entries weighing " << _weight
+            << " of " << _capacity << "; " << _hits << " hits, "
+            << _misses << " misses" << std::endl;
+    }
+
+private:
+
+    /** as HashTable::_rehash */
+    static std::size_t _rehash(std::size_t h) {
+        h ^= h >> 11;
+        h *= 4294967291; // large 32-bit prime
+        h ^= h >> 23;
+        return h;
+    }
+
+    /**
+     * The link that points (or would point) to the node of a key: the
+     * head of its bucket, or the _chain of the node before it
+     */
+    Node **_chainFor(const KeyType& key) const {
+        Node **chain = &_buckets[_rehash(::hash(key)) & (_size - 1)];
+        while (*chain && ! ((*chain)->_key == key)) {
+            chain = &(*chain)->_chain;
+        }
+        return chain;
+    }
+
+    /** takes a node out of its hash chain and the entry count */
+    void _unchain(Node **chain, Node *n) {
+        *chain = n->_chain;
+        _weight -= n->_weight;
+        _entryCount --;
+    }
+
+    /** keeps a node that is no longer used for the next miss */
+    void _recycle(Node *n) {
+        if (_spare) {
+            delete n;
+        } else {
+            _spare = n;
+        }
+    }
+
+    /** evicts the entry the policy chooses, other than keep */
+    void _evict(const Node *keep) {
+        Node *victim = _order.victim(keep);
+        _order.removed(victim);
+        _unchain(_chainFor(victim->_key), victim);
+        _recycle(victim);
+    }
+
+    /** doubles the number of buckets, relinking (not reallocating) nodes */
+    void _grow() {
+        Node **old = _buckets;
+        std::size_t oldSize = _size;
+        _size *= 2;
+        _buckets = new Node*[_size]();
+        for (std::size_t i=0; i<oldSize; i++) {
+            while (old[i]) {
+                Node *n = old[i];
+                old[i] = n->_chain;
+                Node **head = &_buckets[_rehash(::hash(n->_key)) & (_size - 1)];
+                n->_chain = *head;
+                *head = n;
+            }
+        }
+        delete[] old;
+    }
+};
+
+#endif // __CACHE_H
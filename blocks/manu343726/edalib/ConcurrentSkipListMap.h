@@ -0,0 +1,524 @@
+/**
+ * @file ConcurrentSkipListMap.h
+ *
+ * An ordered map that many threads can use at once, implemented with a
+ * lock-free skip list. Similar to Java's ConcurrentSkipListMap
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __CONCURRENTSKIPLISTMAP_H
+#define __CONCURRENTSKIPLISTMAP_H
+
+#include "Util.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(ConcurrentSkipListMapNoSuchElement)
+DECLARE_EXCEPTION(ConcurrentSkipListMapInvalidAccess)
+
+/**
+ * An ordered map implemented with a lock-free skip list: each entry is
+ * in the bottom list, and in each list above it with probability
+ * levelProbability, so lookups skip ahead through the upper lists.
+ * find, insert, erase and iteration can be called from any number of
+ * threads at once; none of them takes a lock. All are O(log N) expected.
+ *
+ * Removal is lazy: erase first marks the links out of a node (the low
+ * bit of a link is its mark), which removes it logically, and then any
+ * thread that walks past a marked node unlinks it. Marked nodes are not
+ * freed, since other threads may still be looking at them; call
+ * compact() when no other thread uses the map, or let the destructor
+ * free them. Values are replaced, not modified, when a key is inserted
+ * again; old values are kept until compact() too.
+ *
+ * Iterators are weakly consistent: they never fail and never visit an
+ * entry twice, and they see every entry that is in the map for the
+ * whole iteration, but may or may not see concurrent changes. elem()
+ * and value() return copies. Keys and values must be copyable, and keys
+ * default-constructible.
+ */
+template <class KeyType, class ValueType>
+class ConcurrentSkipListMap{
+private:
+    typedef std::pair<const KeyType, ValueType> Entry;
+
+    /// maximum number of lists; enough for 2^32 entries with probability 0.5
+    static const int MAX_LEVEL = 32;
+
+    /** a value, and the next one in the list of values to free */
+    struct Value {
+        ValueType _value;
+        Value* _nextAllocated;
+        bool _live; ///< only used by compact()
+
+        Value(const ValueType& value) : _value(value), _nextAllocated(0), _live(false) {}
+    };
+
+    /**
+     * An entry, linked into the lists 0.._height-1. Its links are
+     * allocated right after it, so that they share its cache lines:
+     * build with create() and free with destroy().
+     */
+    struct Node {
+        KeyType _key;
+        std::atomic<Value*> _value;
+        int _height;
+        std::atomic<std::uintptr_t>* _next; ///< marked links to the next node in each list; 0 at the end
+        Node* _nextAllocated;               ///< next node in the list of nodes to free
+
+        static Node *create(const KeyType& key, Value* value, int height) {
+            void *memory = ::operator new(sizeof(Node) + height * sizeof(std::atomic<std::uintptr_t>));
+            try {
+                return new (memory) Node(key, value, height);
+            } catch (...) {
+                ::operator delete(memory);
+                throw;
+            }
+        }
+
+        static void destroy(Node *n) {
+            n->~Node();
+            ::operator delete(n);
+        }
+
+    private:
+        Node(const KeyType& key, Value* value, int height)
+            : _key(key), _value(value), _height(height),
+              _next(reinterpret_cast<std::atomic<std::uintptr_t>*>(this + 1)), _nextAllocated(0) {
+            for (int i = 0; i < height; i++) {
+                new (_next + i) std::atomic<std::uintptr_t>(0);
+            }
+        }
+    };
+
+    Node* _head;                           ///< sentinel with MAX_LEVEL links; its key is never used
+    std::atomic<int> _height;              ///< number of lists that may be in use
+    std::atomic<std::size_t> _entryCount;  ///< number of entries not removed
+    std::atomic<Node*> _allocatedNodes;    ///< every node but the head, to free them later
+    std::atomic<Value*> _allocatedValues;  ///< every value, to free them later
+    std::atomic<std::uint64_t> _levelSeed; ///< source of random levels
+    std::uint32_t _levelThreshold;         ///< levelProbability, scaled to 2^32
+
+public:
+
+    /**
+     * @param levelProbability probability that an entry in a list is also
+     * in the one above; lower values use less memory but search longer
+     */
+    explicit ConcurrentSkipListMap(double levelProbability = 0.5)
+        : _head(Node::create(KeyType(), 0, MAX_LEVEL)), _height(1), _entryCount(0),
+          _allocatedNodes(0), _allocatedValues(0), _levelSeed(0),
+          _levelThreshold((std::uint32_t)(levelProbability * 4294967295.0)) {}
+
+    /** copies the entries of a map; not atomic if other threads change it */
+    ConcurrentSkipListMap(const ConcurrentSkipListMap& other)
+        : _head(Node::create(KeyType(), 0, MAX_LEVEL)), _height(1), _entryCount(0),
+          _allocatedNodes(0), _allocatedValues(0), _levelSeed(0),
+          _levelThreshold(other._levelThreshold) {
+        for (Iterator it = other.begin(); it != other.end(); it.next()) {
+            insert(it.key(), it.value());
+        }
+    }
+
+    /**  */
+    ~ConcurrentSkipListMap() {
+        _free();
+        Node::destroy(_head);
+    }
+
+    /** not atomic if other threads change either map */
+    ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap& other) {
+        if (this != &other) {
+            _free();
+            for (int i = 0; i < MAX_LEVEL; i++) {
+                _head->_next[i].store(0);
+            }
+            _entryCount.store(0);
+            _height.store(1);
+            _levelThreshold = other._levelThreshold;
+            for (Iterator it = other.begin(); it != other.end(); it.next()) {
+                insert(it.key(), it.value());
+            }
+        }
+        return *this;
+    }
+
+    /** number of entries; only a hint while other threads change the map */
+    std::size_t size() const {
+        return _entryCount.load();
+    }
+
+    class Iterator{
+    public:
+        /** moves to the next entry that has not been removed */
+        void next() {
+            if ( ! _current) {
+                throw ConcurrentSkipListMapInvalidAccess("next");
+            }
+            _current = _nextAlive(_current);
+        }
+
+        Entry elem() const {
+            return Entry(key(), value());
+        }
+
+        ValueType value() const {
+            return _current->_value.load()->_value;
+        }
+
+        const KeyType& key() const {
+            return _current->_key;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class ConcurrentSkipListMap;
+
+        /** current node, 0 at the end */
+        Node* _current;
+
+        /** */
+        Iterator(Node* current) : _current(current) {}
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** */
+    const Iterator find(const KeyType& key) const {
+        Node *n = _lowerBound(key);
+        return Iterator(n && ! (key < n->_key) ? n : 0);
+    }
+
+    /**
+     * Returns an iterator to the first entry with a key that is
+     * not less than the given one; handy to start range scans.
+     */
+    Iterator lower_bound(const KeyType& key) const {
+        return Iterator(_lowerBound(key));
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(_nextAlive(_head));
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(0);
+    }
+
+    /** returns a copy of the value; it may change right afterwards */
+    ValueType at(const KeyType& key) const {
+        const Iterator it = find(key);
+        if (it == end()) {
+            throw ConcurrentSkipListMapNoSuchElement("at");
+        }
+        return it.value();
+    }
+
+    /**
+     * Inserts an entry, or replaces the value of an existing key. The
+     * new node is first linked into the bottom list (which is when it
+     * becomes visible), then into the upper lists one by one.
+     */
+    void insert(const KeyType& key, const ValueType& value) {
+        Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        Value *v = _allocateValue(value);
+        for (;;) {
+            if (_find(key, preds, succs)) {
+                succs[0]->_value.store(v);
+                return;
+            }
+            Node *n = _allocateNode(key, v, _randomHeight());
+            int height = _height.load();
+            while (height < n->_height && ! _height.compare_exchange_weak(height, n->_height)) {
+            }
+            for (int i = 0; i < n->_height; i++) {
+                n->_next[i].store(_link(succs[i]), std::memory_order_relaxed);
+            }
+            std::uintptr_t expected = _link(succs[0]);
+            if ( ! preds[0]->_next[0].compare_exchange_strong(expected, _link(n))) {
+                // lost a race; the node stays allocated, unlinked, until compact()
+                _markAll(n);
+                continue;
+            }
+            _entryCount ++;
+            for (int i = 1; i < n->_height; i++) {
+                for (;;) {
+                    expected = _link(succs[i]);
+                    if (preds[i]->_next[i].compare_exchange_strong(expected, _link(n))) {
+                        break;
+                    }
+                    _find(key, preds, succs);
+                    // point the node to its new successor, unless it is being removed
+                    std::uintptr_t link = n->_next[i].load();
+                    if (_marked(link) || ! n->_next[i].compare_exchange_strong(link, _link(succs[i]))) {
+                        return;
+                    }
+                }
+            }
+            return;
+        }
+    }
+
+    /**
+     * Removes an entry: marks its links from the top list down; whoever
+     * marks the bottom one removes it. Throws if the key is not there.
+     */
+    void erase(const KeyType& key) {
+        Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        if ( ! _find(key, preds, succs)) {
+            throw ConcurrentSkipListMapNoSuchElement("erase");
+        }
+        Node *n = succs[0];
+        for (int i = n->_height - 1; i > 0; i--) {
+            _mark(n->_next[i]);
+        }
+        std::uintptr_t link = n->_next[0].load();
+        while ( ! _marked(link)) {
+            if (n->_next[0].compare_exchange_weak(link, link | 1)) {
+                _entryCount --;
+                // unlinks it from every list
+                _find(key, preds, succs);
+                return;
+            }
+        }
+        throw ConcurrentSkipListMapNoSuchElement("erase");
+    }
+
+    /**
+     * Frees the nodes of removed entries and replaced values. Not
+     * thread-safe: no other thread may use the map meanwhile, and it
+     * invalidates iterators to removed entries.
+     */
+    void compact() {
+        // unlink every marked node from every list
+        for (int i = 0; i < MAX_LEVEL; i++) {
+            Node *pred = _head;
+            while (Node *n = _node(pred->_next[i].load())) {
+                std::uintptr_t link = n->_next[i].load();
+                if (_marked(link)) {
+                    pred->_next[i].store(_link(_node(link)));
+                } else {
+                    pred = n;
+                }
+            }
+        }
+        Node *liveNodes = 0;
+        for (Node *n = _allocatedNodes.load(), *next; n; n = next) {
+            next = n->_nextAllocated;
+            if (_marked(n->_next[0].load())) {
+                Node::destroy(n);
+            } else {
+                n->_value.load()->_live = true;
+                n->_nextAllocated = liveNodes;
+                liveNodes = n;
+            }
+        }
+        _allocatedNodes.store(liveNodes);
+        Value *liveValues = 0;
+        for (Value *v = _allocatedValues.load(), *next; v; v = next) {
+            next = v->_nextAllocated;
+            if ( ! v->_live) {
+                delete v;
+            } else {
+                v->_live = false;
+                v->_nextAllocated = liveValues;
+                liveValues = v;
+            }
+        }
+        _allocatedValues.store(liveValues);
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (Iterator it = begin(); it != end(); it.next()) {
+            out << it.key() << " -> " << it.value() << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        std::size_t nodes = 0, links = 0, removed = 0, values = 0;
+        int levels = 0;
+        for (Node *n = _allocatedNodes.load(); n; n = n->_nextAllocated) {
+            nodes ++;
+            links += n->_height;
+            removed += _marked(n->_next[0].load()) ? 1 : 0;
+        }
+        for (Value *v = _allocatedValues.load(); v; v = v->_nextAllocated) {
+            values ++;
+        }
+        while (levels < MAX_LEVEL && _head->_next[levels].load()) {
+            levels ++;
+        }
+        out << "total of " << size() << " entries in " << levels << " lists; "
+            << nodes << " nodes (" << removed << " removed) with "
+            << (nodes ? (float)links / nodes : 0.0f) << " links each, "
+            << values << " values"
+            << std::endl;
+    }
+
+private:
+
+    static bool _marked(std::uintptr_t link) {
+        return link & 1;
+    }
+
+    static Node *_node(std::uintptr_t link) {
+        return reinterpret_cast<Node*>(link & ~(std::uintptr_t)1);
+    }
+
+    static std::uintptr_t _link(Node *n) {
+        return reinterpret_cast<std::uintptr_t>(n);
+    }
+
+    /** sets the mark of a link, if it is not already set */
+    static void _mark(std::atomic<std::uintptr_t>& link) {
+        std::uintptr_t l = link.load();
+        while ( ! _marked(l) && ! link.compare_exchange_weak(l, l | 1)) {
+        }
+    }
+
+    static void _markAll(Node *n) {
+        for (int i = 0; i < n->_height; i++) {
+            _mark(n->_next[i]);
+        }
+    }
+
+    /** next node in the bottom list that is not marked, 0 if none */
+    static Node *_nextAlive(Node *n) {
+        n = _node(n->_next[0].load());
+        while (n && _marked(n->_next[0].load())) {
+            n = _node(n->_next[0].load());
+        }
+        return n;
+    }
+
+    /**
+     * Looks for a key from the top list down, unlinking the marked nodes
+     * it walks past. Fills, for each list, the last node with a smaller
+     * key (preds) and the one after it (succs, 0 if none).
+     * @return true if succs[0] has the key
+     */
+    bool _find(const KeyType& key, Node **preds, Node **succs) const {
+    retry:
+        Node *pred = _head;
+        int height = _height.load();
+        for (int i = height; i < MAX_LEVEL; i++) {
+            preds[i] = _head;
+            succs[i] = 0;
+        }
+        for (int i = height - 1; i >= 0; i--) {
+            Node *curr = _node(pred->_next[i].load());
+            while (curr) {
+                std::uintptr_t succ = curr->_next[i].load();
+                while (_marked(succ)) {
+                    std::uintptr_t expected = _link(curr);
+                    if ( ! pred->_next[i].compare_exchange_strong(expected, _link(_node(succ)))) {
+                        goto retry;
+                    }
+                    curr = _node(succ);
+                    if ( ! curr) {
+                        break;
+                    }
+                    succ = curr->_next[i].load();
+                }
+                if (curr && curr->_key < key) {
+                    pred = curr;
+                    curr = _node(succ);
+                } else {
+                    break;
+                }
+            }
+            preds[i] = pred;
+            succs[i] = curr;
+        }
+        return succs[0] && ! (key < succs[0]->_key);
+    }
+
+    /** first node not marked with a key not less than the given one; does not unlink */
+    Node *_lowerBound(const KeyType& key) const {
+        Node *pred = _head, *curr = 0;
+        for (int i = _height.load() - 1; i >= 0; i--) {
+            curr = _node(pred->_next[i].load());
+            while (curr) {
+                std::uintptr_t succ = curr->_next[i].load();
+                if ( ! _marked(succ) && ! (curr->_key < key)) {
+                    break;
+                } else if ( ! _marked(succ)) {
+                    pred = curr;
+                }
+                curr = _node(succ);
+            }
+        }
+        return curr;
+    }
+
+    /** geometric height: each extra level with probability levelProbability */
+    int _randomHeight() {
+        int height = 1;
+        for (;;) {
+            // splitmix64 over a shared counter: one atomic add per draw, and 2 draws per level
+            std::uint64_t z = _levelSeed.fetch_add(0x9e3779b97f4a7c15ULL) + 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            for (int draws = 0; draws < 2; draws++, z >>= 32) {
+                if (height == MAX_LEVEL || (std::uint32_t)z >= _levelThreshold) {
+                    return height;
+                }
+                height ++;
+            }
+        }
+    }
+
+    Node *_allocateNode(const KeyType& key, Value *value, int height) {
+        Node *n = Node::create(key, value, height);
+        n->_nextAllocated = _allocatedNodes.load();
+        while ( ! _allocatedNodes.compare_exchange_weak(n->_nextAllocated, n)) {
+        }
+        return n;
+    }
+
+    Value *_allocateValue(const ValueType& value) {
+        Value *v = new Value(value);
+        v->_nextAllocated = _allocatedValues.load();
+        while ( ! _allocatedValues.compare_exchange_weak(v->_nextAllocated, v)) {
+        }
+        return v;
+    }
+
+    void _free() {
+        for (Node *n = _allocatedNodes.exchange(0), *next; n; n = next) {
+            next = n->_nextAllocated;
+            Node::destroy(n);
+        }
+        for (Value *v = _allocatedValues.exchange(0), *next; v; v = next) {
+            next = v->_nextAllocated;
+            delete v;
+        }
+    }
+};
+
+#endif // __CONCURRENTSKIPLISTMAP_H
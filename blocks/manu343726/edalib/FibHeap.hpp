@@ -16,6 +16,7 @@
 #define	FIBHEAP_HPP
 
 #include <list>
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <utility>
@@ -23,6 +24,8 @@
 #include <manu343726/portable_cpp/specifiers.hpp>
 #include <cassert>
 #include <cmath>
+#include <new>
+#include <type_traits>
 
 #include "container_adapters.hpp"
 
@@ -41,6 +44,135 @@ namespace impl
 			key{ std::forward<ARGS>(args)... }
 		{}
 	};
+
+	/*
+	 * A free-list allocator for single objects (heap nodes), which carves them from
+	 * chunks of growing size (up to MAX_CHUNK objects) and recycles deallocated ones
+	 * instead of freeing them. Memory is only returned when the pool is destroyed.
+	 *
+	 * Each copy is an independent (and initially empty) pool, so a pool must only
+	 * deallocate what it allocated itself. Arrays are passed through to operator new.
+	 */
+	template<typename T, std::size_t MAX_CHUNK = 4096>
+	class node_pool
+	{
+	public:
+		using value_type = T;
+		using pointer = T*;
+		using const_pointer = const T*;
+		using reference = T&;
+		using const_reference = const T&;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+
+		template<typename U>
+		struct rebind
+		{
+			using other = node_pool<U, MAX_CHUNK>;
+		};
+
+		node_pool() NOEXCEPT :
+			_free{ nullptr },
+			_chunks{ nullptr },
+			_next_chunk{ 16 }
+		{}
+
+		node_pool(const node_pool&) NOEXCEPT : node_pool{} {}
+
+		template<typename U>
+		node_pool(const node_pool<U, MAX_CHUNK>&) NOEXCEPT : node_pool{} {}
+
+		node_pool& operator=(const node_pool&) = delete;
+
+		~node_pool()
+		{
+			while(_chunks != nullptr)
+			{
+				slot* next = _chunks->next;
+				::operator delete(_chunks);
+				_chunks = next;
+			}
+		}
+
+		T* allocate(std::size_t n)
+		{
+			if(n != 1)
+				return static_cast<T*>(::operator new(n * sizeof(T)));
+
+			if(_free == nullptr)
+				_grow();
+
+			slot* s = _free;
+			_free = s->next;
+
+			return reinterpret_cast<T*>(s);
+		}
+
+		void deallocate(T* p, std::size_t n) NOEXCEPT
+		{
+			if(n != 1)
+			{
+				::operator delete(p);
+				return;
+			}
+
+			slot* s = reinterpret_cast<slot*>(p);
+			s->next = _free;
+			_free = s;
+		}
+
+		template<typename U, typename... ARGS>
+		void construct(U* p, ARGS&&... args)
+		{
+			::new(static_cast<void*>(p)) U(std::forward<ARGS>(args)...);
+		}
+
+		template<typename U>
+		void destroy(U* p)
+		{
+			p->~U();
+		}
+
+		bool operator==(const node_pool& other) const NOEXCEPT
+		{
+			return this == &other;
+		}
+
+		bool operator!=(const node_pool& other) const NOEXCEPT
+		{
+			return this != &other;
+		}
+
+	private:
+		//A free slot links to the next one; an allocated one holds an object
+		union slot
+		{
+			slot* next;
+			typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+		};
+
+		slot* _free;             //first free slot
+		slot* _chunks;           //last allocated chunk, whose first slot links to the previous one
+		std::size_t _next_chunk; //number of slots of the next chunk
+
+		void _grow()
+		{
+			slot* chunk = static_cast<slot*>(::operator new(_next_chunk * sizeof(slot)));
+
+			chunk[0].next = _chunks;
+			_chunks = chunk;
+
+			//Slot 0 is the chunk header, the rest are threaded into the free list
+			for(std::size_t i = _next_chunk - 1; i > 0; --i)
+			{
+				chunk[i].next = _free;
+				_free = chunk + i;
+			}
+
+			if(_next_chunk < MAX_CHUNK)
+				_next_chunk *= 2;
+		}
+	};
 }
 
 #if defined(EDALIB_FIBHEAP_TIMING)
@@ -59,18 +191,57 @@ namespace impl
  * Fibonacci Heap
  * 
  * Implements a heap with fast insertion (O(1)) and min retrieveing (O(1)).
+ * insert() returns a handle to the element, which can later be passed to
+ * decrease_key() (amortized O(1)) or erase() (amortized O(log n)).
  * 
  * Template parameters:
  * ====================
  * 
  *  - T: Element type. Should meet the DefaultConstructible concept?
  *  - Compare: Comparator type. std::less<T> by default.
- *  - Allocator: Allocator type. std::allocator<T> by default.
+ *  - Allocator: Node allocator type. impl::node_pool by default, which recycles the
+ *               nodes of extracted elements for later insertions, saving a malloc()
+ *               and a free() per element.
  */
-template<typename T , typename Compare = std::less<T>, typename Allocator = std::allocator<impl::node<T>>>
+template<typename T , typename Compare = std::less<T>, typename Allocator = impl::node_pool<impl::node<T>>>
 class FibHeap
 {
+	using node = impl::node<T>;
+
 public:
+    /**
+     * Refers to an element of the heap, from its insertion until it is
+     * extracted or erased. Handles stay valid as the heap is restructured,
+     * since elements are never moved nor copied.
+     */
+    class handle
+    {
+    public:
+        handle() : _node{ nullptr } {}
+
+        const T& key() const
+        {
+            return _node->key;
+        }
+
+        bool operator==(const handle& other) const
+        {
+            return _node == other._node;
+        }
+
+        bool operator!=(const handle& other) const
+        {
+            return _node != other._node;
+        }
+
+    private:
+        friend class FibHeap;
+
+        node* _node;
+
+        explicit handle(node* n) : _node{ n } {}
+    };
+
     /**
      * Constructs an empty heap. 
      */
@@ -78,7 +249,8 @@ public:
 		_compare( compare ), //I love uniform initialization until I hate uniform initilization... See https://travis-ci.org/Manu343726/edalib/builds/42541893
 		_factory(alloc),
 		_min{ nullptr },
-		_size{0}
+		_size{0},
+		_registry{}
 	{
 		_check_integrity_all();
 	}
@@ -107,10 +279,13 @@ public:
     }
 
 	template<typename... ARGS>
-	void insert(ARGS&&... args)
+	handle insert(ARGS&&... args)
 	{
         EDALIB_FIBHEAP_TIMER
-		_insert(_factory.create(std::forward<ARGS>(args)...));
+        node* n = _factory.create(std::forward<ARGS>(args)...);
+		_insert(n);
+
+        return handle{ n };
 	}
     
     T extract_min()
@@ -130,6 +305,57 @@ public:
 		return _min->key;
 	}
 
+    /**
+     * Replaces the key of an element with a smaller (or equal) one. The
+     * element is cut from its parent if it now precedes it, and so are
+     * those of its ancestors that had already lost a child (the cascading
+     * cut), which keeps the trees bushy enough for extract_min() to stay
+     * O(log n).
+     */
+    void decrease_key(handle h, const T& key)
+    {
+        EDALIB_FIBHEAP_TIMER
+        node* n = h._node;
+        assert(n != nullptr && !_compare(n->key, key));
+
+        n->key = key;
+
+        node* parent = n->parent;
+
+        if(parent != nullptr && _compare(n->key, parent->key))
+        {
+            _cut(n);
+            _cascading_cut(parent);
+        }
+
+        if(_compare(n->key, _min->key))
+            _min = n;
+
+        _check_integrity_all();
+    }
+
+    /**
+     * Removes an element, as if its key was decreased below any other and
+     * then extracted. The handle is no longer valid afterwards.
+     */
+    void erase(handle h)
+    {
+        EDALIB_FIBHEAP_TIMER
+        node* n = h._node;
+        assert(n != nullptr);
+
+        node* parent = n->parent;
+
+        if(parent != nullptr)
+        {
+            _cut(n);
+            _cascading_cut(parent);
+        }
+
+        _min = n;
+        _extract_min();
+    }
+
 	template<typename F>
 	void foreach(F f) const
 	{
@@ -158,8 +384,6 @@ public:
     }
 
 private:
-	using node = impl::node<T>;
-    
     //This class manages node creation and destruction.
     //Helps debugging traking memory allocations (See _check_integrity_memory() bellow)
     class node_factory
@@ -214,10 +438,15 @@ private:
         std::size_t _allocations, _deallocations;
     };
 
+    //A node of degree d roots at least F(d+2) >= phi^d nodes, so degrees stay below 64
+    //for any heap that fits in memory (phi^64 nodes would take hundreds of terabytes)
+    static const std::size_t MAX_DEGREE = 64;
+    
 	node* _min; //pointer to the node containning the minimum value.
 	std::size_t _size;
 	Compare _compare;
 	node_factory _factory;
+    node* _registry[MAX_DEGREE]; //Roots by degree while consolidating. All null otherwise
     
     void _set_min(node* min)
     {
@@ -272,15 +501,18 @@ private:
         node* z = _min;
         node* child = _min->child;
         
-        //This step can be optimized moving the chain in one step attaching its ends directly
-        //instead of moving each node. But since there are no marks identifying that ends, taking them has
-        //O(n) complexity too, so there's no real gain.
+        //The children become roots: the whole chain is spliced into the rootschain at once,
+        //but their parent pointers still have to be cleared one by one (There are O(log n) of them)
         if(child != nullptr)
         {
             do_forwards(child, [&](node* sibling)
             {
-                _add_to_rootschain(_min, sibling);
+                sibling->parent = nullptr;
             });
+            
+            _splice(z, child);
+            z->child = nullptr;
+            z->degree = 0;
         }
 
         node* right = z->right;
@@ -302,86 +534,89 @@ private:
     void _consolidate()
     {
         EDALIB_FIBHEAP_TIMER_INTERNALS
-        //The "registry", starting with 2 * log_2(n) null pointers
-        std::vector<node*> a{ (std::size_t)(2*std::log2(size())), nullptr};
-        
-        //Auxiliary functions:
-        //This functions help to have enough space to operate on the registry while
-        //reading/writting on it still have a clear and simple interface.
-        
-        auto setup_registry = [&](std::size_t degree)
-        {
-            //Just for the case the registry is not big enough, add 
-            //more node references
-            while(a.size() < degree + 1)
-                a.push_back(nullptr);
-        };
-        
-        auto registry = [&](std::size_t degree) -> node*& //No type inference, return by reference please (To allow assignment calls)
+        //Walks the rootschain once, linking roots of the same degree. Linking only moves
+        //roots already walked (those in the registry) or the current one, so the next root
+        //and the last one are never moved and the walk can go on from them.
+        node* last = _min->left;
+        node* root = _min;
+        std::size_t max_degree = 0;
+        bool done;
+        
+        do
         {
-            setup_registry(degree);
+            node* next = root->right;
+            done = root == last;
             
-            assert(a.size() > degree);
+            node* x = root;
+            std::size_t degree = x->degree;
             
-            return a[degree];
-        };
-        
-        
-        do_foreach(_min, [&](node* root)
-        {
-           node* x = root;
-           std::size_t degree = x->degree;
-           
-            while(registry(degree) != nullptr)
-            {   
-               node* y = registry(degree);
-
-                    //NOTE: _compare always compares for less. That is, _compare(a,b) returns true if
-                    //      a < b given a certain criteria. That said, if(x->key > y->key) is the same
-                    //      as if(y->key < y->key).
-                    if(_compare(y->key, x->key))
-                        std::swap(x,y);
-
-                    _link(x,y);
-       
-                    registry(degree) = nullptr;
-               
+            while(_registry[degree] != nullptr)
+            {
+                node* y = _registry[degree];
+                
+                //NOTE: _compare always compares for less. That is, _compare(a,b) returns true if
+                //      a < b given a certain criteria. That said, if(x->key > y->key) is the same
+                //      as if(y->key < x->key).
+                if(_compare(y->key, x->key))
+                    std::swap(x,y);
+                
+                _link(x,y);
+                
+                _registry[degree] = nullptr;
                 degree++;
+                assert(degree < MAX_DEGREE);
             }
-           
-           registry(degree) = x;
-        });
+            
+            _registry[degree] = x;
+            max_degree = std::max(max_degree, degree);
+            root = next;
+        } while(!done);
         
+        //The roots left in the registry are the ones left in the rootschain, so only
+        //the min has to be found again. The registry is cleared on the way for the next call
         _min = nullptr;
         
-        for(node* n : a)
+        for(std::size_t degree = 0; degree <= max_degree; ++degree)
+        {
+            node* n = _registry[degree];
+            _registry[degree] = nullptr;
+            
+            if(n != nullptr && (_min == nullptr || _compare(n->key, _min->key)))
+                _min = n;
+        }
+    }
+    
+    /*
+     * Moves a node (and its subtree) from the childs of its parent to the rootschain
+     */
+    void _cut(node* n)
+    {
+        EDALIB_FIBHEAP_TIMER_INTERNALS
+        assert(n->parent != nullptr);
+        
+        _remove_from_rootschain(n);
+        _add_to_rootschain(_min, n);
+        n->modified = false;
+    }
+    
+    /*
+     * Goes up from a node which has just lost a child: The first child lost only marks
+     * the node as modified, the second one cuts it too, and goes on with its parent
+     */
+    void _cascading_cut(node* n)
+    {
+        EDALIB_FIBHEAP_TIMER_INTERNALS
+        while(n->parent != nullptr)
         {
-            if(n != nullptr)
+            if(!n->modified)
             {
-                //NOTE: This part differs from the implementation guide. The original pseudocode is:
-                //
-                //   _add_to_rootschain(_min, n);
-                // 
-                //   if(_min == nullptr || _compare(n->key, _min->key))
-                //       _min = n;
-                //
-                //This was modified (actually reordered) to take care of null _min. I use
-                //_min to track the main rootschain (The H rootschain in the guide), so adding
-                //n to the _min chain directly is not possible.
-                //Instead, I check for null _min first.
-                
-                if(_min == nullptr)
-                {
-                    _min = n;
-                }
-                else
-                {
-                    _add_to_rootschain(_min, n);
-                    
-                    if(_compare(n->key, _min->key))
-                        _min = n;
-                }
+                n->modified = true;
+                return;
             }
+            
+            node* parent = n->parent;
+            _cut(n);
+            n = parent;
         }
     }
     
@@ -405,6 +640,7 @@ private:
         {
             assert(parent->degree == 0);
             parent->child = child;
+            parent->degree = 1;
             child->left = child;
             child->right = child;
         }
@@ -423,7 +659,6 @@ private:
     {
         EDALIB_FIBHEAP_TIMER_INTERNALS
         if(root == n) return;
-        if(root->left == n || root->right == n) return;
         
         node* left = root->left;
         
@@ -466,13 +701,37 @@ private:
         //Can walk from root->left to root->right in one step after extracting root from the sibling chain?
         _check_integrity_reachable(left, right, 1);
         
-        if(root->parent != nullptr)
+        node* parent = root->parent;
+        
+        if(parent != nullptr)
         {
-            root->parent->degree--;
-            _check_integrity_node_degree(root->parent);
+            if(parent->child == root)
+                parent->child = (right == root) ? nullptr : right;
+            
+            parent->degree--;
+            root->parent = nullptr;
+            _check_integrity_node_degree(parent);
         }
     }
     
+    /*
+     * Joins two sibling chains into one, in O(1). No parent nor degree is updated
+     */
+    void _splice(node* a, node* b)
+    {
+        EDALIB_FIBHEAP_TIMER_INTERNALS
+        node* a_right = a->right;
+        node* b_left = b->left;
+        
+        a->right = b;
+        b->left = a;
+        b_left->right = a_right;
+        a_right->left = b_left;
+        
+        _check_integrity_node_siblings(a);
+        _check_integrity_node_siblings(b);
+    }
+    
     std::size_t _count_siblings(node* n) const NOEXCEPT
     {
         EDALIB_FIBHEAP_TIMER_INTERNALS
@@ -16,7 +16,11 @@
 #define __HASHTABLE_H
 
 #include "Util.h"
+#include "Vector.h"
+#include "DoubleList.h"
+#include "BloomFilter.h"
 
+#include <iomanip>
 #include <utility> //std::pair<const key,value> instead of custom pair class
 
 DECLARE_EXCEPTION(HashTableNoSuchElement)
@@ -37,7 +41,7 @@ inline std::size_t hash(char key) {
 }
 
 /// used in Java jdk7
-inline std::size_t hash(std::string key) {
+inline std::size_t hash(const std::string& key) {
     std::size_t h = 0;
     for (std::size_t i=0; i<key.length(); i++) {
         h = 31*h + key[i];
@@ -63,7 +67,7 @@ std::size_t hash(const KeyType& key) {
 template <class KeyType, class ValueType>
 class HashTable{
 private:
-    typedef std::pair<KeyType, ValueType> Entry;
+    typedef typename MapEntry<KeyType, ValueType>::type Entry;
     typedef DoubleList<Entry> Bin;
     typedef typename Bin::Iterator BinIterator;
     
@@ -76,31 +80,57 @@ private:
     Bin* _bins;         ///< bins to store elements in
     std::size_t _size;         ///< current number of bins
     std::size_t _entryCount;   ///< number of key-value entries stored
+    BlockedBloomFilter* _filter; ///< hashes of the keys, if filtering; 0 if not
+    std::size_t _filterStale;  ///< keys erased since the filter was built
 
 public:
 
     /**  */
-    HashTable() : _size(INITIAL_SIZE), _entryCount(0) {
+    HashTable() : _size(INITIAL_SIZE), _entryCount(0), _filter(0), _filterStale(0) {
         _bins = new Bin[_size];
     }
     
+    /**  */
+    HashTable(const HashTable& other) : _size(other._size), _entryCount(other._entryCount),
+            _filter(other._filter ? new BlockedBloomFilter(*other._filter) : 0),
+            _filterStale(other._filterStale) {
+        _bins = new Bin[_size];
+        for (std::size_t i=0; i<_size; i++) {
+            _bins[i] = other._bins[i];
+        }
+    }
+    
+    /**  */
+    HashTable(HashTable&& other) : _size(INITIAL_SIZE), _entryCount(0), _filter(0), _filterStale(0) {
+        _bins = new Bin[_size];
+        *this = std::move(other);
+    }
+    
     /**  */
     ~HashTable() {
         delete[] _bins;
         _bins = 0;
+        delete _filter;
     }
     
     /** */
     HashTable& operator=(const HashTable& other) {
-        delete[] _bins;
-        _size = other._size;
-        _bins = new Bin[_size];
-        _entryCount = other.size();
-        for (std::size_t i=0; i<other.size(); i++) {
-            _bins[i] = other._bins[i];
+        if (this != &other) {
+            HashTable copy(other);
+            *this = std::move(copy);
         }
         return (*this);
     }    
+    
+    /** */
+    HashTable& operator=(HashTable&& other) {
+        std::swap(_bins, other._bins);
+        std::swap(_size, other._size);
+        std::swap(_entryCount, other._entryCount);
+        std::swap(_filter, other._filter);
+        std::swap(_filterStale, other._filterStale);
+        return (*this);
+    }    
 
     /**  */
     std::size_t size() const {
@@ -161,9 +191,27 @@ public:
     
     ADD_ITERATOR_TRAITS()
     
+    /**
+     * Puts a blocked Bloom filter of the keys in front of the bins, so
+     * that looking up (or erasing) an absent key, in all but about 1% of
+     * cases, reads a single cache line instead of walking a bin and
+     * comparing keys. Best when most lookups miss. Costs 10 bits per
+     * entry and a little time per insertion; the filter is rebuilt when
+     * the table grows, and when erased keys pile up in it.
+     */
+    void enable_filter() {
+        if ( ! _filter) {
+            _rebuildFilter();
+        }
+    }
+
     /** */
     const Iterator find(const KeyType& key) const {
-        Bin& bin = _bins[_binFor(key)];
+        std::size_t h = _hashOf(key);
+        if ( ! _mayContain(h)) {
+            return end();
+        }
+        Bin& bin = _bins[h % _size];
         const BinIterator& it = _findIn(bin, key);
         return (it == bin.end()) ? end() 
             : Iterator(this, &bin, it);
@@ -181,7 +229,11 @@ public:
     
     /** */
     const ValueType& at(const KeyType& key) const {        
-        const Bin& bin  = _bins[_binFor(key)];
+        std::size_t h = _hashOf(key);
+        if ( ! _mayContain(h)) {
+            throw HashTableNoSuchElement("at");
+        }
+        const Bin& bin  = _bins[h % _size];
         const BinIterator it = _findIn(bin, key);
         if (it == bin.end()) {
             throw HashTableNoSuchElement("at");
@@ -196,10 +248,14 @@ public:
     
     /** */
     void insert(const KeyType& key, const ValueType& value) {
-        Bin& bin  = _bins[_binFor(key)];
-        BinIterator it = _findIn(bin, key);
+        std::size_t h = _hashOf(key);
+        Bin& bin  = _bins[h % _size];
+        BinIterator it = _mayContain(h) ? _findIn(bin, key) : bin.end();
         if (it == bin.end()) {
             bin.push_back(Entry(key, value));
+            if (_filter) {
+                _filter->add(h);
+            }
             _entryCount ++;
             if (_entryCount / _size >= MAX_LOAD_FACTOR) {
                 _grow();
@@ -211,13 +267,17 @@ public:
     
     /** */
     void erase(const KeyType& key) {
-        Bin& bin = _bins[_binFor(key)];
-        BinIterator it = _findIn(bin, key);
+        std::size_t h = _hashOf(key);
+        Bin& bin = _bins[h % _size];
+        BinIterator it = _mayContain(h) ? _findIn(bin, key) : bin.end();
         if (it == bin.end()) {
             throw HashTableNoSuchElement("erase");
         } else {
             bin.erase(it);
             _entryCount --;
+            if (_filter && ++ _filterStale >= _size * MAX_LOAD_FACTOR / 2) {
+                _rebuildFilter();
+            }
         }
     }
     
@@ -257,8 +317,25 @@ private:
         return h;
     }
     
-    int _binFor(const KeyType& key) const {
-        return _rehash(::hash(key)) % _size;
+    std::size_t _hashOf(const KeyType& key) const {
+        return _rehash(::hash(key));
+    }
+
+    /** false if the filter is sure that there is no key with that hash */
+    bool _mayContain(std::size_t h) const {
+        return ! _filter || _filter->mayContain(h);
+    }
+
+    /** a filter for as many entries as fit before the next _grow */
+    void _rebuildFilter() {
+        delete _filter;
+        _filter = new BlockedBloomFilter(_size * MAX_LOAD_FACTOR);
+        for (std::size_t i=0; i<_size; i++) {
+            for (BinIterator it=_bins[i].begin(); it!=_bins[i].end(); it.next()) {
+                _filter->add(_hashOf(it.elem().first));
+            }
+        }
+        _filterStale = 0;
     }
     
     BinIterator _findIn(const Bin& bin, const KeyType& key) const {
@@ -279,13 +356,37 @@ private:
         _size *= 2;
         _bins = new Bin[_size];
         _entryCount = 0;
+        if (_filter) {
+            delete _filter;
+            _filter = new BlockedBloomFilter(_size * MAX_LOAD_FACTOR);
+            _filterStale = 0;
+        }
         while (allEntries.size()) {
             const Entry& entry = allEntries.back();            
-            Bin& bin  = _bins[_binFor(entry.first)];
+            std::size_t h = _hashOf(entry.first);
+            if (_filter) {
+                _filter->add(h);
+            }
+            Bin& bin  = _bins[h % _size];
             allEntries.moveBackTo(bin);
             _entryCount ++;
         }
     }
 };
 
+/**
+ * A HashTable with its filter enabled (see HashTable::enable_filter),
+ * for tables where most lookups miss. Can be used wherever a
+ * template<typename,typename> associative container is expected (as
+ * in BaseMap and BaseSet).
+ */
+template <class KeyType, class ValueType>
+class FilteredHashTable : public HashTable<KeyType, ValueType>{
+public:
+    /**  */
+    FilteredHashTable() {
+        this->enable_filter();
+    }
+};
+
 #endif // __HASHTABLE_H
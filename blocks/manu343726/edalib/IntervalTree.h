@@ -0,0 +1,329 @@
+/**
+ * @file IntervalTree.h
+ *
+ * A map from half-open intervals to values that finds the intervals
+ * overlapping a point or another interval
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __INTERVALTREE_H
+#define __INTERVALTREE_H
+
+#include "Util.h"
+#include "BinTree.h"
+
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(IntervalTreeNoSuchElement)
+DECLARE_EXCEPTION(IntervalTreeInvalidAccess)
+
+/**
+ * A map from half-open intervals [start, end) to values, implemented
+ * using an augmented AVL tree: entries are sorted by start (and then
+ * end), and each node also keeps the largest end in its subtree. That
+ * is enough to skip every subtree that ends before a query begins, and
+ * everything to the right of one that starts after the query ends.
+ *
+ * Lookups, insertions and removals take O(log N). Reporting the K
+ * intervals that contain a point, or overlap an interval, takes
+ * O(log N + K log(N/K)) at worst; close to O(log N + K) when, as usual,
+ * the intervals found are not spread all over the tree.
+ */
+template <class PointType, class ValueType>
+class IntervalTree{
+public:
+    /** a half-open interval: contains start, but not end */
+    struct Interval {
+        PointType start;
+        PointType end;
+
+        Interval(const PointType& start, const PointType& end)
+            : start(start), end(end) {}
+
+        bool operator<(const Interval& other) const {
+            return start < other.start || ( ! (other.start < start) && end < other.end);
+        }
+
+        bool operator==(const Interval& other) const {
+            return ! (*this < other) && ! (other < *this);
+        }
+    };
+
+    typedef std::pair<const Interval, ValueType> Entry;
+
+private:
+    /** an entry, and the largest end of its subtree */
+    struct Annotated {
+        Entry _entry;
+        PointType _maxEnd;
+
+        Annotated(const Entry& entry)
+            : _entry(entry), _maxEnd(entry.first.end) {}
+    };
+
+    typedef BinTree<Annotated> Tree;
+    typedef typename Tree::Node Node;
+
+    Tree _t; ///< sorted, balanced binary tree for interval-value entries
+    std::size_t _entryCount;  ///< number of interval-value entries in tree
+
+public:
+
+    /**  */
+    IntervalTree() : _t(), _entryCount(0) {}
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    /** number of nodes in the longest path from the root; 0 if empty */
+    std::size_t height() const {
+        return Tree::height(_t._root);
+    }
+
+    /** iterates entries sorted by start, then by end */
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _current) {
+                throw IntervalTreeInvalidAccess("next");
+            }
+            _current = Tree::nextInOrder(_current);
+        }
+
+        const Entry& elem() const {
+            return _current->_elem._entry;
+        }
+
+        const ValueType& value() const {
+            return _current->_elem._entry.second;
+        }
+
+        const Interval& key() const {
+            return _current->_elem._entry.first;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class IntervalTree;
+
+        /** current node, 0 at the end */
+        Node* _current;
+
+        /** */
+        Iterator(Node* current) : _current(current) {}
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** finds an interval, with the same start and end */
+    const Iterator find(const PointType& start, const PointType& end) const {
+        return Iterator(_nodeFor(Interval(start, end)));
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(Tree::firstInOrder(_t._root));
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(0);
+    }
+
+    /** */
+    const ValueType& at(const PointType& start, const PointType& end) const {
+        Node *n = _nodeFor(Interval(start, end));
+        if ( ! n) {
+            throw IntervalTreeNoSuchElement("at");
+        }
+        return n->_elem._entry.second;
+    }
+
+    /** */
+    ValueType& at(const PointType& start, const PointType& end) {
+        NON_CONST_VARIANT(ValueType,IntervalTree,at(start, end));
+    }
+
+    /** inserts [start, end), or overwrites its value if already there */
+    void insert(const PointType& start, const PointType& end, const ValueType& value) {
+        _t._root = _insert(_t._root, Interval(start, end), value);
+        _t._root->_parent = 0;
+    }
+
+    /** */
+    void erase(const PointType& start, const PointType& end) {
+        _t._root = _erase(_t._root, Interval(start, end));
+        if (_t._root) {
+            _t._root->_parent = 0;
+        }
+        _entryCount --;
+    }
+
+    /**
+     * Calls visitor(entry) for each interval that contains the point,
+     * sorted by start
+     */
+    template <class Visitor>
+    void containing(const PointType& point, Visitor visitor) const {
+        _overlapping(_t._root, point, point, true, visitor);
+    }
+
+    /**
+     * Calls visitor(entry) for each interval that overlaps [start, end),
+     * sorted by start. Empty queries overlap nothing
+     */
+    template <class Visitor>
+    void overlapping(const PointType& start, const PointType& end, Visitor visitor) const {
+        if (start < end) {
+            _overlapping(_t._root, start, end, false, visitor);
+        }
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (Iterator it = begin(); it != end(); it.next()) {
+            out << "[" << it.key().start << ", " << it.key().end << ") -> "
+                << it.value() << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        out << "total of " << _entryCount << " intervals; height is "
+            << Tree::height(_t._root) << std::endl;
+    }
+
+private:
+
+    /**
+     * Visits, in order, the intervals of a subtree that end after lo and
+     * start before hi (or at hi, if inclusive)
+     */
+    template <class Visitor>
+    static void _overlapping(Node *n, const PointType& lo, const PointType& hi,
+                             bool inclusive, Visitor& visitor) {
+        // right subtrees are walked in a loop; only left ones recurse
+        while (n && lo < n->_elem._maxEnd) {
+            _overlapping(n->_left, lo, hi, inclusive, visitor);
+            const Interval& interval = n->_elem._entry.first;
+            if (inclusive ? hi < interval.start : ! (interval.start < hi)) {
+                return; // so do all those to the right
+            }
+            if (lo < interval.end) {
+                visitor(n->_elem._entry);
+            }
+            n = n->_right;
+        }
+    }
+
+    /** recomputes the largest end of a subtree from those of its children */
+    static void _updateMaxEnd(Node *n) {
+        if (n) {
+            PointType& max = n->_elem._maxEnd;
+            max = n->_elem._entry.first.end;
+            if (n->_left && max < n->_left->_elem._maxEnd) {
+                max = n->_left->_elem._maxEnd;
+            }
+            if (n->_right && max < n->_right->_elem._maxEnd) {
+                max = n->_right->_elem._maxEnd;
+            }
+        }
+    }
+
+    /**
+     * As Tree::rebalance, keeping largest ends up to date. Rotations
+     * only change the children of the new root and the root itself
+     */
+    static Node *_rebalance(Node *n) {
+        n = Tree::rebalance(n);
+        _updateMaxEnd(n->_left);
+        _updateMaxEnd(n->_right);
+        _updateMaxEnd(n);
+        return n;
+    }
+
+    /** as TreeMap::_nodeFor, without the parent */
+    Node *_nodeFor(const Interval& interval) const {
+        Node *n = _t._root;
+        while (n && ! (n->_elem._entry.first == interval)) {
+            n = interval < n->_elem._entry.first ? n->_left : n->_right;
+        }
+        return n;
+    }
+
+    /** as TreeMap::_insert */
+    Node *_insert(Node *n, const Interval& interval, const ValueType& value) {
+        if ( ! n) {
+            _entryCount ++;
+            return _t.createNode(Annotated(Entry(interval, value)));
+        }
+        const Interval& nodeInterval = n->_elem._entry.first;
+        if (nodeInterval == interval) {
+            n->_elem._entry.second = value;
+            return n;
+        } else if (interval < nodeInterval) {
+            Tree::setLeft(n, _insert(n->_left, interval, value));
+        } else {
+            Tree::setRight(n, _insert(n->_right, interval, value));
+        }
+        return _rebalance(n);
+    }
+
+    /** as TreeMap::_erase */
+    static Node *_erase(Node *n, const Interval& interval) {
+        if ( ! n) {
+            throw IntervalTreeNoSuchElement("erase");
+        }
+        const Interval& nodeInterval = n->_elem._entry.first;
+        if (nodeInterval == interval) {
+            Node *replacement;
+            if ( ! n->_left) {
+                replacement = n->_right;
+            } else if ( ! n->_right) {
+                replacement = n->_left;
+            } else {
+                Node *right = _detachSmallest(n->_right, replacement);
+                Tree::setLeft(replacement, n->_left);
+                Tree::setRight(replacement, right);
+            }
+            delete n;
+            return replacement ? _rebalance(replacement) : 0;
+        } else if (interval < nodeInterval) {
+            Tree::setLeft(n, _erase(n->_left, interval));
+        } else {
+            Tree::setRight(n, _erase(n->_right, interval));
+        }
+        return _rebalance(n);
+    }
+
+    /** as TreeMap::_detachSmallest */
+    static Node *_detachSmallest(Node *n, Node *&smallest) {
+        if ( ! n->_left) {
+            smallest = n;
+            return n->_right;
+        }
+        Tree::setLeft(n, _detachSmallest(n->_left, smallest));
+        return _rebalance(n);
+    }
+};
+
+#endif // __INTERVALTREE_H
@@ -17,6 +17,9 @@
 
 #include "HashTable.h"
 #include "TreeMap.h"
+#include "BPlusTreeMap.h"
+#include "SplayTreeMap.h"
+#include "MultiMap.h"
 
 /**
  * Maps allow key, value pairs to be stored. The keys are used
@@ -83,17 +86,109 @@ public:
     std::size_t size() const {
         return _m.size();
     }
+
+    /** adds the entries of other, overwriting values; only for TreeMap-backed maps */
+    void union_with(const BaseMap& other) {
+        _m.union_with(other._m);
+    }
+
+    /** keeps the entries with keys in other; only for TreeMap-backed maps */
+    void intersect_with(const BaseMap& other) {
+        _m.intersect_with(other._m);
+    }
+
+    /** erases the entries with keys in other; only for TreeMap-backed maps */
+    void difference_with(const BaseMap& other) {
+        _m.difference_with(other._m);
+    }
+};
+
+/**
+ * Multimaps store any number of values under each key; inserting
+ * under an already-inserted key adds another key, value pair. The
+ * values of a key are kept together, in insertion order, and can be
+ * looked up, counted and erased at once.
+ */
+template <class KeyType, class ValueType, template<typename,typename> class Container>
+class BaseMultiMap{
+
+    /**
+     * Internal associative container.
+     * Must support iteration (begin, end, find), lookup of all the
+     * pairs of a key (equal_range, count), removal of all the pairs
+     * of a key (erase), insertion (insert), and size
+     */
+    Container<KeyType,ValueType> _m;
+
+public:
+
+    /** */
+    typedef typename Container<KeyType,ValueType>::Iterator Iterator;
+
+    /** the pairs of a key, as a [begin, end) range */
+    typedef typename Container<KeyType,ValueType>::Range Range;
+
+    /**  */
+    Iterator begin() const {
+        return _m.begin();
+    }
+
+    /**  */
+    Iterator end() const {
+        return _m.end();
+    }
+
+    /**  */
+    bool contains(const KeyType& key) const {
+        return _m.find(key) != _m.end();
+    }
+
+    /** the values under a key, in insertion order */
+    Range equal_range(const KeyType& key) const {
+        return _m.equal_range(key);
+    }
+
+    /** the number of values under a key */
+    std::size_t count(const KeyType& key) const {
+        return _m.count(key);
+    }
+
+    /** adds a value under a key, after any already there */
+    void insert(const KeyType& key, const ValueType& value) {
+        _m.insert(key, value);
+    }
+
+    /** erases every value under a key, returning how many there were */
+    std::size_t erase(const KeyType& key) {
+        return _m.erase(key);
+    }
+
+    /**  */
+    std::size_t size() const {
+        return _m.size();
+    }
 };
 
 /**
- * Pre-built maps using a HashTable and a TreeMap as backup containers
+ * Pre-built maps using a HashTable, a TreeMap, a BPlusTreeMap and a SplayTreeMap as backup containers,
+ * and multimaps using a HashMultiMap and a TreeMultiMap
  */
 template <class KeyType, class ValueType>
 struct Map {
     /// Map::H is a HashTable-backed set, and is not ordered
     typedef BaseMap<KeyType, ValueType, HashTable> H;
+    /// Map::HF is Map::H with a Bloom filter in front; best when most lookups miss
+    typedef BaseMap<KeyType, ValueType, FilteredHashTable> HF;
     /// Map::M is a TreeMap-backed set, and is always ordered
-    typedef BaseMap<KeyType, ValueType, TreeMap> T;    
+    typedef BaseMap<KeyType, ValueType, DefaultTreeMap> T;    
+    /// Map::B is a BPlusTreeMap-backed map, and is always ordered
+    typedef BaseMap<KeyType, ValueType, DefaultBPlusTreeMap> B;
+    /// Map::S is a SplayTreeMap-backed map, and is always ordered; best when few keys get most lookups
+    typedef BaseMap<KeyType, ValueType, SplayTreeMap> S;
+    /// Map::MH is a HashMultiMap-backed multimap, and is not ordered
+    typedef BaseMultiMap<KeyType, ValueType, HashMultiMap> MH;
+    /// Map::MT is a TreeMultiMap-backed multimap, and is always ordered
+    typedef BaseMultiMap<KeyType, ValueType, TreeMultiMap> MT;
 };
 
 #endif // __MAP_H
@@ -0,0 +1,258 @@
+/**
+ * @file MultiMap.h
+ *
+ * A map that keeps any number of values per key, built on top of any
+ * of the other maps. Similar to std::multimap and std::unordered_multimap
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __MULTIMAP_H
+#define __MULTIMAP_H
+
+#include "Util.h"
+#include "HashTable.h"
+#include "TreeMap.h"
+
+#include <vector>
+
+DECLARE_EXCEPTION(MultiMapInvalidAccess)
+
+/**
+ * The values a multimap keeps under a key, in insertion order. The
+ * first one is kept inline, so that keys with a single value need no
+ * allocation of their own; the rest are kept together, so that listing
+ * them does not chase a pointer per value.
+ */
+template <class ValueType>
+class ValueGroup{
+public:
+    explicit ValueGroup(const ValueType& value) : _first(value) {}
+
+    std::size_t size() const {
+        return 1 + _rest.size();
+    }
+
+    const ValueType& at(std::size_t pos) const {
+        return pos ? _rest[pos - 1] : _first;
+    }
+
+    void push_back(const ValueType& value) {
+        _rest.push_back(value);
+    }
+
+private:
+    ValueType _first;
+    std::vector<ValueType> _rest;
+};
+
+/** multisets only need to count the copies of each key */
+template <>
+class ValueGroup<EmptyClass>{
+public:
+    explicit ValueGroup(const EmptyClass&) : _size(1) {}
+
+    std::size_t size() const {
+        return _size;
+    }
+
+    const EmptyClass& at(std::size_t) const {
+        static const EmptyClass empty = EmptyClass();
+        return empty;
+    }
+
+    void push_back(const EmptyClass&) {
+        _size ++;
+    }
+
+private:
+    std::size_t _size;
+};
+
+/**
+ * A multimap: inserting under a key that is already there adds
+ * another value, instead of overwriting it. Each key is stored once,
+ * in any of the other maps (a Container such as HashTable or TreeMap),
+ * together with the group of its values; so the values of a key are
+ * found with a single lookup, counted in O(1) once found, erased at
+ * once, and iterated in insertion order without walking a list.
+ *
+ * Iteration visits every key-value entry, keys in the order of the
+ * container, and the values of each key in insertion order.
+ */
+template <class KeyType, class ValueType, template<typename,typename> class Container>
+class MultiMap{
+private:
+    typedef ValueGroup<ValueType> Group;
+    typedef Container<KeyType, Group> Groups;
+    typedef typename Groups::Iterator GroupIterator;
+
+    Groups _groups;            ///< values of each key
+    std::size_t _entryCount;   ///< number of key-value entries, in all groups
+
+public:
+
+    /**  */
+    MultiMap() : _groups(), _entryCount(0) {}
+
+    /** number of key-value entries */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    class Iterator{
+    public:
+        void next() {
+            if (_it == _end) {
+                throw MultiMapInvalidAccess("next");
+            }
+            if (++ _pos == _it.value().size()) {
+                _pos = 0;
+                _it.next();
+            }
+        }
+
+        const ValueType& value() const {
+            return _it.value().at(_pos);
+        }
+
+        const KeyType& key() const {
+            return _it.key();
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _it == other._it && _pos == other._pos;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return ! (*this == other);
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class MultiMap;
+
+        GroupIterator _it;   ///< current key
+        GroupIterator _end;  ///< end of the container, where next() stops
+        std::size_t _pos;    ///< current value, within those of the key
+
+        Iterator(const GroupIterator& it, const GroupIterator& end)
+            : _it(it), _end(end), _pos(0) {}
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** the first entry with the key; end() if none */
+    const Iterator find(const KeyType& key) const {
+        return Iterator(_groups.find(key), _groups.end());
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(_groups.begin(), _groups.end());
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(_groups.end(), _groups.end());
+    }
+
+    /**
+     * The entries with a given key, as a half-open interval
+     * [begin, end). Iterate it as any other container.
+     */
+    class Range{
+    public:
+        Iterator begin() const {
+            return _begin;
+        }
+
+        Iterator end() const {
+            return _end;
+        }
+
+    protected:
+        friend class MultiMap;
+
+        Iterator _begin, _end;
+
+        Range(const Iterator& begin, const Iterator& end)
+            : _begin(begin), _end(end) {}
+    };
+
+    /** Returns the entries with the given key, in insertion order */
+    Range equal_range(const KeyType& key) const {
+        GroupIterator it = _groups.find(key), end = _groups.end();
+        if (it == end) {
+            return Range(this->end(), this->end());
+        }
+        Iterator first(it, end);
+        it.next();
+        return Range(first, Iterator(it, end));
+    }
+
+    /** Returns the number of entries with the given key */
+    std::size_t count(const KeyType& key) const {
+        GroupIterator it = _groups.find(key);
+        return it == _groups.end() ? 0 : it.value().size();
+    }
+
+    /** Adds an entry, after any others with the same key */
+    void insert(const KeyType& key, const ValueType& value) {
+        if (_groups.find(key) == _groups.end()) {
+            _groups.insert(key, Group(value));
+        } else {
+            _groups.at(key).push_back(value);
+        }
+        _entryCount ++;
+    }
+
+    /**
+     * Erases every entry with the given key, at the cost of erasing one
+     * key from the container
+     * @return the number of erased entries; 0 if there were none
+     */
+    std::size_t erase(const KeyType& key) {
+        std::size_t erased = count(key);
+        if (erased) {
+            _groups.erase(key);
+            _entryCount -= erased;
+        }
+        return erased;
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (Iterator it = begin(); it != end(); it.next()) {
+            out << it.key() << " -> " << it.value() << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        out << "total of " << _entryCount << " entries under "
+            << _groups.size() << " keys" << std::endl;
+    }
+};
+
+/**
+ * A MultiMap on a HashTable. Can be used wherever a
+ * template<typename,typename> associative container is expected (as
+ * in BaseMultiMap and BaseSet).
+ */
+template <class KeyType, class ValueType>
+using HashMultiMap = MultiMap<KeyType, ValueType, HashTable>;
+
+/** A MultiMap on a TreeMap, sorted by std::less. As HashMultiMap */
+template <class KeyType, class ValueType>
+using TreeMultiMap = MultiMap<KeyType, ValueType, DefaultTreeMap>;
+
+#endif // __MULTIMAP_H
@@ -0,0 +1,415 @@
+/**
+ * @file PersistentTreeMap.h
+ *
+ * A map implemented using a persistent sorted tree: copies are O(1)
+ * snapshots that later changes do not affect. Similar to std::map
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __PERSISTENTTREEMAP_H
+#define __PERSISTENTTREEMAP_H
+
+#include "Util.h"
+
+#include <atomic>
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(PersistentTreeMapNoSuchElement)
+DECLARE_EXCEPTION(PersistentTreeMapInvalidAccess)
+
+/**
+ * A map implemented using a persistent AVL tree. Versions share all the
+ * nodes they have in common, and each node counts the versions (and
+ * parent nodes) that refer to it: copying a map is O(1), and a node is
+ * freed when the last version that uses it goes away.
+ *
+ * insert and erase change only the version they are called on, by path
+ * copying: the O(log N) nodes on the path to the key are copied, unless
+ * no other version shares them, in which case they are changed in
+ * place (so a map that is never copied allocates no more than a TreeMap).
+ * inserted and erased leave the map alone and return the new version.
+ *
+ * Different versions can be used (and dropped) from different threads;
+ * a single version cannot be changed by one thread while others use it.
+ * Iterators remain valid while their version is neither changed nor
+ * destroyed; take a snapshot to iterate while changing the map. Values
+ * can only be changed through insert, since they may be shared.
+ */
+template <class KeyType, class ValueType>
+class PersistentTreeMap{
+private:
+    typedef std::pair<const KeyType, ValueType> Entry;
+
+    /** a node, shared by all the versions and parents that refer to it */
+    struct Node {
+        Entry _elem;
+        Node* _left;   ///< left child, 0 if none; owns one reference to it
+        Node* _right;  ///< right child, 0 if none; owns one reference to it
+        int _height;   ///< height of the subtree rooted here, 1 for leaves
+        std::atomic<std::size_t> _refs; ///< number of parents and versions using this node
+
+        Node(const Entry& elem, Node *left, Node *right)
+            : _elem(elem), _left(left), _right(right), _height(1), _refs(1) {
+            update(this);
+        }
+    };
+
+    /// enough for any AVL tree that fits in memory
+    static const int MAX_HEIGHT = 96;
+
+    Node* _root;              ///< root of this version; owns one reference to it
+    std::size_t _entryCount;  ///< number of key-value entries in this version
+
+public:
+
+    /**  */
+    PersistentTreeMap() : _root(0), _entryCount(0) {}
+
+    /** a snapshot, in O(1) */
+    PersistentTreeMap(const PersistentTreeMap& other)
+        : _root(_retain(other._root)), _entryCount(other._entryCount) {}
+
+    /**  */
+    PersistentTreeMap(PersistentTreeMap&& other)
+        : _root(other._root), _entryCount(other._entryCount) {
+        other._root = 0;
+        other._entryCount = 0;
+    }
+
+    /**  */
+    ~PersistentTreeMap() {
+        _release(_root);
+    }
+
+    /** a snapshot, in O(1) */
+    PersistentTreeMap& operator=(const PersistentTreeMap& other) {
+        Node *old = _root;
+        _root = _retain(other._root);
+        _entryCount = other._entryCount;
+        _release(old);
+        return *this;
+    }
+
+    /**  */
+    PersistentTreeMap& operator=(PersistentTreeMap&& other) {
+        std::swap(_root, other._root);
+        std::swap(_entryCount, other._entryCount);
+        return *this;
+    }
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    /** number of nodes in the longest path from the root; 0 if empty */
+    std::size_t height() const {
+        return height(_root);
+    }
+
+    /**
+     * Iterates in key order. There are no parent pointers (a node may
+     * have many parents), so iterators keep the path from the root to
+     * the current node; or rather, the nodes on it still to visit.
+     */
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _depth) {
+                throw PersistentTreeMapInvalidAccess("next");
+            }
+            Node *n = _path[-- _depth];
+            for (n = n->_right; n; n = n->_left) {
+                _path[_depth ++] = n;
+            }
+        }
+
+        const Entry& elem() const {
+            return _current()->_elem;
+        }
+
+        const ValueType& value() const {
+            return _current()->_elem.second;
+        }
+
+        const KeyType& key() const {
+            return _current()->_elem.first;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current() == other._current();
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current() != other._current();
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() : _depth(0) {}
+
+    protected:
+        friend class PersistentTreeMap;
+
+        /** ancestors of the current node whose left subtree holds it, and the node itself (on top) */
+        Node* _path[MAX_HEIGHT];
+        int _depth;
+
+        Node *_current() const {
+            return _depth ? _path[_depth - 1] : 0;
+        }
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** */
+    const Iterator find(const KeyType& key) const {
+        Iterator it = lower_bound(key);
+        return it != end() && ! (key < it.key()) ? it : end();
+    }
+
+    /**
+     * Returns an iterator to the first entry with a key that is
+     * not less than the given one; end() if none. O(log N)
+     */
+    Iterator lower_bound(const KeyType& key) const {
+        Iterator it;
+        for (Node *n = _root; n; ) {
+            if (n->_elem.first < key) {
+                n = n->_right;
+            } else {
+                it._path[it._depth ++] = n;
+                n = n->_left;
+            }
+        }
+        return it;
+    }
+
+    /** */
+    Iterator begin() const {
+        Iterator it;
+        for (Node *n = _root; n; n = n->_left) {
+            it._path[it._depth ++] = n;
+        }
+        return it;
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator();
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        Node *n = _nodeFor(key);
+        if ( ! n) {
+            throw PersistentTreeMapNoSuchElement("at");
+        }
+        return n->_elem.second;
+    }
+
+    /** */
+    void insert(const KeyType& key, const ValueType& value) {
+        if ( ! _nodeFor(key)) {
+            _entryCount ++;
+        }
+        _root = _insert(_root, key, value);
+    }
+
+    /** */
+    void erase(const KeyType& key) {
+        if ( ! _nodeFor(key)) {
+            throw PersistentTreeMapNoSuchElement("erase");
+        }
+        _root = _erase(_root, key);
+        _entryCount --;
+    }
+
+    /** a new version with the entry inserted; this one does not change */
+    PersistentTreeMap inserted(const KeyType& key, const ValueType& value) const {
+        PersistentTreeMap version(*this);
+        version.insert(key, value);
+        return version;
+    }
+
+    /** a new version without the entry; this one does not change */
+    PersistentTreeMap erased(const KeyType& key) const {
+        PersistentTreeMap version(*this);
+        version.erase(key);
+        return version;
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (Iterator it = begin(); it != end(); it.next()) {
+            out << it.key() << " -> " << it.value() << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        std::size_t shared = 0;
+        for (Iterator it = begin(); it != end(); it.next()) {
+            shared += it._current()->_refs.load() > 1 ? 1 : 0;
+        }
+        out << "total of " << _entryCount << " nodes; height is " << height(_root)
+            << " shared with other versions " << shared << " (and their subtrees)"
+            << std::endl;
+    }
+
+private:
+
+    static int height(Node *n) {
+        return n ? n->_height : 0;
+    }
+
+    static void update(Node *n) {
+        int l = height(n->_left), r = height(n->_right);
+        n->_height = 1 + (l > r ? l : r);
+    }
+
+    static Node *_retain(Node *n) {
+        if (n) {
+            n->_refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    /** drops a reference; frees the node, and drops its children, if it was the last */
+    static void _release(Node *n) {
+        while (n && n->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _release(n->_left);
+            Node *right = n->_right;
+            delete n;
+            n = right;
+        }
+    }
+
+    /**
+     * Takes a reference to a node and returns one to a node with the same
+     * contents that no one else uses: the node itself if it was not shared,
+     * or a copy
+     */
+    static Node *_own(Node *n) {
+        if (n->_refs.load(std::memory_order_acquire) == 1) {
+            return n;
+        }
+        Node *copy = new Node(n->_elem, _retain(n->_left), _retain(n->_right));
+        _release(n);
+        return copy;
+    }
+
+    Node *_nodeFor(const KeyType& key) const {
+        Node *n = _root;
+        while (n) {
+            if (key < n->_elem.first) {
+                n = n->_left;
+            } else if (n->_elem.first < key) {
+                n = n->_right;
+            } else {
+                break;
+            }
+        }
+        return n;
+    }
+
+    /* The following take a reference to the root of a subtree, and
+       return one to the root of the changed subtree */
+
+    static Node *_rotateLeft(Node *n) {
+        Node *r = _own(n->_right);
+        n->_right = r->_left;
+        r->_left = n;
+        update(n);
+        update(r);
+        return r;
+    }
+
+    static Node *_rotateRight(Node *n) {
+        Node *l = _own(n->_left);
+        n->_left = l->_right;
+        l->_right = n;
+        update(n);
+        update(l);
+        return l;
+    }
+
+    /** as BinTree::rebalance; n must not be shared */
+    static Node *_rebalance(Node *n) {
+        update(n);
+        int balance = height(n->_left) - height(n->_right);
+        if (balance > 1) {
+            if (height(n->_left->_left) < height(n->_left->_right)) {
+                n->_left = _rotateLeft(_own(n->_left));
+            }
+            return _rotateRight(n);
+        } else if (balance < -1) {
+            if (height(n->_right->_right) < height(n->_right->_left)) {
+                n->_right = _rotateRight(_own(n->_right));
+            }
+            return _rotateLeft(n);
+        }
+        return n;
+    }
+
+    static Node *_insert(Node *n, const KeyType& key, const ValueType& value) {
+        if ( ! n) {
+            return new Node(Entry(key, value), 0, 0);
+        }
+        n = _own(n);
+        if (key < n->_elem.first) {
+            n->_left = _insert(n->_left, key, value);
+        } else if (n->_elem.first < key) {
+            n->_right = _insert(n->_right, key, value);
+        } else {
+            n->_elem.second = value;
+            return n;
+        }
+        return _rebalance(n);
+    }
+
+    /** the key must be in the subtree */
+    static Node *_erase(Node *n, const KeyType& key) {
+        n = _own(n);
+        if (key < n->_elem.first) {
+            n->_left = _erase(n->_left, key);
+        } else if (n->_elem.first < key) {
+            n->_right = _erase(n->_right, key);
+        } else {
+            Node *left = n->_left, *right = n->_right;
+            n->_left = n->_right = 0;
+            if ( ! left || ! right) {
+                _release(n);
+                return left ? left : right;
+            }
+            // keys are const: the smallest entry on the right goes into a new node
+            Node *smallest;
+            right = _detachSmallest(right, smallest);
+            Node *replacement = new Node(smallest->_elem, left, right);
+            _release(smallest);
+            _release(n);
+            return _rebalance(replacement);
+        }
+        return _rebalance(n);
+    }
+
+    /** removes the smallest node of a subtree, returning a reference to it in smallest */
+    static Node *_detachSmallest(Node *n, Node*& smallest) {
+        if ( ! n->_left) {
+            Node *right = _retain(n->_right);
+            smallest = n;
+            return right;
+        }
+        n = _own(n);
+        n->_left = _detachSmallest(n->_left, smallest);
+        return _rebalance(n);
+    }
+};
+
+#endif // __PERSISTENTTREEMAP_H
@@ -0,0 +1,786 @@
+/**
+ * @file RoaringBitmap.h
+ *
+ * A compressed bitmap of integer keys, for large and dense sets of
+ * integers. Similar to std::set<int>, in a fraction of the space
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __ROARINGBITMAP_H
+#define __ROARINGBITMAP_H
+
+#include "Util.h"
+
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+
+DECLARE_EXCEPTION(RoaringBitmapNoSuchElement)
+DECLARE_EXCEPTION(RoaringBitmapInvalidAccess)
+
+/**
+ * A set of integers of up to 32 bits, kept as a "Roaring" compressed
+ * bitmap. Keys are split into chunks by their upper 16 bits, and each
+ * chunk keeps the lower 16 bits of its keys in whichever takes less space:
+ *  - an array of sorted 16-bit values, 2 bytes per key, for up to 4096 keys;
+ *  - a bitmap with a bit for each of the 2^16 possible values (8 KB);
+ *  - runs of consecutive values, 4 bytes per run. Only optimize() turns
+ *    chunks into runs; insertions and removals keep them as such.
+ *
+ * Lookups are a binary search among chunks and one within the chunk (or
+ * a bit test). Unions, intersections and differences go chunk by chunk,
+ * and combine bitmaps 64 bits at a time, in loops simple enough for the
+ * compiler to vectorize. Iteration is in key order.
+ *
+ * Has the interface of a map to EmptyClass, so that it can back sets
+ * (see Set::R); values can be nothing else.
+ */
+template <class KeyType, class ValueType = EmptyClass>
+class RoaringBitmap {
+    static_assert(std::is_integral<KeyType>::value && sizeof(KeyType) <= 4,
+                  "RoaringBitmap keys are integers of up to 32 bits");
+    static_assert(std::is_same<ValueType, EmptyClass>::value,
+                  "RoaringBitmap is a set: its values are EmptyClass");
+
+    typedef KeyOnlyEntry<KeyType> Entry;
+    typedef std::uint16_t Low;
+    typedef std::uint64_t Word;
+
+    /// more keys than this, and a bitmap takes less space than an array
+    static const std::size_t MAX_ARRAY = 4096;
+    /// more runs than this, and a bitmap takes less space
+    static const std::size_t MAX_RUNS = 2048;
+    /// 64-bit words in a bitmap
+    static const std::size_t WORDS = (1 << 16) / 64;
+
+    /** index of the lowest set bit of a non-zero word */
+    static unsigned _ctz64(Word w) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(w);
+#else
+        // the lowest bit times a de Bruijn sequence has a distinct top 6 bits
+        static const unsigned char INDEX[64] = {
+             0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+            62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+            63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+            46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+        };
+        return INDEX[((w & (0 - w)) * 0x03f79d71b4cb0a89ULL) >> 58];
+#endif
+    }
+
+    /** number of set bits of a word */
+    static unsigned _popcount64(Word w) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(w);
+#else
+        // adds bits in pairs, then nibbles, then bytes, then all bytes at once
+        w = w - ((w >> 1) & 0x5555555555555555ULL);
+        w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+        w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return unsigned((w * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    enum Kind { ARRAY, BITMAP, RUNS };
+
+    /** the keys that share their upper 16 bits */
+    struct Chunk {
+        Kind _kind;               ///< how the lower 16 bits are kept
+        std::uint32_t _count;     ///< number of keys in the chunk, 0 to 2^16
+        std::vector<Low> _lows;   ///< ARRAY: sorted values; RUNS: first and last value of each run, sorted
+        std::vector<Word> _bits;  ///< BITMAP: a bit for each value
+
+        Chunk() : _kind(ARRAY), _count(0) {}
+
+        std::size_t runs() const {
+            return _lows.size() / 2;
+        }
+
+        /** index of the first run that ends at or after low; runs() if none */
+        std::size_t runFor(Low low) const {
+            std::size_t lo = 0, hi = runs();
+            while (lo < hi) {
+                std::size_t mid = (lo + hi) / 2;
+                if (_lows[2 * mid + 1] < low) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        bool contains(Low low) const {
+            switch (_kind) {
+            case ARRAY:
+                return std::binary_search(_lows.begin(), _lows.end(), low);
+            case BITMAP:
+                return (_bits[low >> 6] >> (low & 63)) & 1;
+            default:
+                std::size_t r = runFor(low);
+                return r < runs() && _lows[2 * r] <= low;
+            }
+        }
+
+        /** calls f(low) for each key, in order */
+        template <class F>
+        void forEach(F f) const {
+            switch (_kind) {
+            case ARRAY:
+                for (Low low : _lows) {
+                    f(low);
+                }
+                break;
+            case BITMAP:
+                for (std::size_t i = 0; i < WORDS; i++) {
+                    for (Word w = _bits[i]; w; w &= w - 1) {
+                        f(Low(i * 64 + _ctz64(w)));
+                    }
+                }
+                break;
+            case RUNS:
+                for (std::size_t r = 0; r < runs(); r++) {
+                    for (std::uint32_t low = _lows[2 * r]; low <= _lows[2 * r + 1]; low++) {
+                        f(Low(low));
+                    }
+                }
+                break;
+            }
+        }
+
+        std::size_t countRuns() const {
+            std::size_t count = 0;
+            if (_kind == RUNS) {
+                count = runs();
+            } else if (_kind == BITMAP) {
+                // a run starts at each set bit whose previous bit is clear
+                Word previous = 0;
+                for (std::size_t i = 0; i < WORDS; i++) {
+                    Word w = _bits[i];
+                    count += _popcount64(w & ~((w << 1) | (previous >> 63)));
+                    previous = w;
+                }
+            } else {
+                for (std::size_t i = 0; i < _lows.size(); i++) {
+                    count += (i == 0 || _lows[i] != _lows[i - 1] + 1) ? 1 : 0;
+                }
+            }
+            return count;
+        }
+
+        void recount() {
+            std::uint32_t count = 0;
+            for (std::size_t i = 0; i < WORDS; i++) {
+                count += _popcount64(_bits[i]);
+            }
+            _count = count;
+        }
+
+        void convert(Kind kind) {
+            if (kind == _kind) {
+                return;
+            }
+            std::vector<Low> lows;
+            std::vector<Word> bits;
+            if (kind == BITMAP) {
+                bits.assign(WORDS, 0);
+                forEach([&](Low low) { bits[low >> 6] |= Word(1) << (low & 63); });
+            } else if (kind == ARRAY) {
+                lows.reserve(_count);
+                forEach([&](Low low) { lows.push_back(low); });
+            } else {
+                forEach([&](Low low) {
+                    if ( ! lows.empty() && lows.back() + 1 == low) {
+                        lows.back() = low;
+                    } else {
+                        lows.push_back(low);
+                        lows.push_back(low);
+                    }
+                });
+            }
+            _lows.swap(lows);
+            _bits.swap(bits);
+            _kind = kind;
+        }
+
+        /**
+         * Switches to whichever of an array or a bitmap takes less space;
+         * or to runs, if they take even less and either tryRuns is set or
+         * the chunk already kept runs
+         */
+        void settle(bool tryRuns) {
+            Kind kind = _count <= MAX_ARRAY ? ARRAY : BITMAP;
+            if (tryRuns || _kind == RUNS) {
+                std::size_t bytes = kind == ARRAY ? 2 * _count : WORDS * 8;
+                if (4 * countRuns() < bytes) {
+                    kind = RUNS;
+                }
+            }
+            convert(kind);
+        }
+
+        /** sets (or clears) the bits from first to last, both included */
+        static void fill(std::vector<Word>& bits, std::uint32_t first, std::uint32_t last, bool set) {
+            std::size_t firstWord = first >> 6, lastWord = last >> 6;
+            Word firstMask = ~Word(0) << (first & 63);
+            Word lastMask = ~Word(0) >> (63 - (last & 63));
+            for (std::size_t i = firstWord; i <= lastWord; i++) {
+                Word mask = (i == firstWord ? firstMask : ~Word(0)) & (i == lastWord ? lastMask : ~Word(0));
+                bits[i] = set ? bits[i] | mask : bits[i] & ~mask;
+            }
+        }
+
+        /** sets the bits of the keys of this chunk in a bitmap */
+        void addTo(std::vector<Word>& bits) const {
+            if (_kind == BITMAP) {
+                for (std::size_t i = 0; i < WORDS; i++) {
+                    bits[i] |= _bits[i];
+                }
+            } else if (_kind == RUNS) {
+                for (std::size_t r = 0; r < runs(); r++) {
+                    fill(bits, _lows[2 * r], _lows[2 * r + 1], true);
+                }
+            } else {
+                for (Low low : _lows) {
+                    bits[low >> 6] |= Word(1) << (low & 63);
+                }
+            }
+        }
+
+        /** clears the bits of the keys of this chunk in a bitmap */
+        void removeFrom(std::vector<Word>& bits) const {
+            if (_kind == BITMAP) {
+                for (std::size_t i = 0; i < WORDS; i++) {
+                    bits[i] &= ~_bits[i];
+                }
+            } else if (_kind == RUNS) {
+                for (std::size_t r = 0; r < runs(); r++) {
+                    fill(bits, _lows[2 * r], _lows[2 * r + 1], false);
+                }
+            } else {
+                for (Low low : _lows) {
+                    bits[low >> 6] &= ~(Word(1) << (low & 63));
+                }
+            }
+        }
+
+        /** @return false if already there */
+        bool insert(Low low) {
+            switch (_kind) {
+            case ARRAY: {
+                typename std::vector<Low>::iterator it = std::lower_bound(_lows.begin(), _lows.end(), low);
+                if (it != _lows.end() && *it == low) {
+                    return false;
+                }
+                if (_count < MAX_ARRAY) {
+                    _lows.insert(it, low);
+                    break;
+                }
+                convert(BITMAP);
+            }
+            // falls through - full arrays become bitmaps
+            case BITMAP: {
+                Word& w = _bits[low >> 6];
+                Word bit = Word(1) << (low & 63);
+                if (w & bit) {
+                    return false;
+                }
+                w |= bit;
+                break;
+            }
+            case RUNS: {
+                std::size_t r = runFor(low);
+                if (r < runs() && _lows[2 * r] <= low) {
+                    return false;
+                }
+                bool extendsPrevious = r > 0 && _lows[2 * r - 1] + 1 == low;
+                bool extendsNext = r < runs() && _lows[2 * r] == low + 1;
+                if (extendsPrevious && extendsNext) {
+                    _lows[2 * r - 1] = _lows[2 * r + 1];
+                    _lows.erase(_lows.begin() + 2 * r, _lows.begin() + 2 * r + 2);
+                } else if (extendsPrevious) {
+                    _lows[2 * r - 1] = low;
+                } else if (extendsNext) {
+                    _lows[2 * r] = low;
+                } else {
+                    Low run[] = { low, low };
+                    _lows.insert(_lows.begin() + 2 * r, run, run + 2);
+                }
+                break;
+            }
+            }
+            _count++;
+            if (_kind == RUNS && runs() > MAX_RUNS) {
+                settle(false);
+            }
+            return true;
+        }
+
+        /** @return false if not there */
+        bool erase(Low low) {
+            switch (_kind) {
+            case ARRAY: {
+                typename std::vector<Low>::iterator it = std::lower_bound(_lows.begin(), _lows.end(), low);
+                if (it == _lows.end() || *it != low) {
+                    return false;
+                }
+                _lows.erase(it);
+                break;
+            }
+            case BITMAP: {
+                Word& w = _bits[low >> 6];
+                Word bit = Word(1) << (low & 63);
+                if ( ! (w & bit)) {
+                    return false;
+                }
+                w &= ~bit;
+                break;
+            }
+            case RUNS: {
+                std::size_t r = runFor(low);
+                if (r == runs() || low < _lows[2 * r]) {
+                    return false;
+                }
+                Low first = _lows[2 * r], last = _lows[2 * r + 1];
+                if (first == last) {
+                    _lows.erase(_lows.begin() + 2 * r, _lows.begin() + 2 * r + 2);
+                } else if (low == first) {
+                    _lows[2 * r] = low + 1;
+                } else if (low == last) {
+                    _lows[2 * r + 1] = low - 1;
+                } else {
+                    // splits the run in two
+                    Low run[] = { Low(low + 1), last };
+                    _lows[2 * r + 1] = low - 1;
+                    _lows.insert(_lows.begin() + 2 * r + 2, run, run + 2);
+                }
+                break;
+            }
+            }
+            _count--;
+            if ((_kind == BITMAP && _count <= MAX_ARRAY) || (_kind == RUNS && runs() > MAX_RUNS)) {
+                settle(false);
+            }
+            return true;
+        }
+
+        /** adds the keys of a chunk with the same upper bits */
+        void unite(const Chunk& other) {
+            bool runs = _kind == RUNS || other._kind == RUNS;
+            if (_kind == ARRAY && other._kind == ARRAY && _count + other._count <= MAX_ARRAY) {
+                std::vector<Low> lows;
+                lows.reserve(_count + other._count);
+                std::set_union(_lows.begin(), _lows.end(), other._lows.begin(), other._lows.end(),
+                               std::back_inserter(lows));
+                _lows.swap(lows);
+                _count = _lows.size();
+                return;
+            }
+            convert(BITMAP);
+            other.addTo(_bits);
+            recount();
+            settle(runs);
+        }
+
+        /** keeps the keys also in a chunk with the same upper bits */
+        void intersect(const Chunk& other) {
+            bool runs = _kind == RUNS || other._kind == RUNS;
+            if (_kind == ARRAY || other._kind == ARRAY) {
+                std::vector<Low> lows;
+                if (_kind == ARRAY && other._kind == ARRAY) {
+                    std::set_intersection(_lows.begin(), _lows.end(), other._lows.begin(), other._lows.end(),
+                                          std::back_inserter(lows));
+                } else {
+                    const Chunk& array = _kind == ARRAY ? *this : other;
+                    const Chunk& rest = _kind == ARRAY ? other : *this;
+                    for (Low low : array._lows) {
+                        if (rest.contains(low)) {
+                            lows.push_back(low);
+                        }
+                    }
+                }
+                _lows.swap(lows);
+                std::vector<Word>().swap(_bits);
+                _kind = ARRAY;
+                _count = _lows.size();
+            } else {
+                convert(BITMAP);
+                if (other._kind == BITMAP) {
+                    for (std::size_t i = 0; i < WORDS; i++) {
+                        _bits[i] &= other._bits[i];
+                    }
+                } else {
+                    std::vector<Word> mask(WORDS, 0);
+                    other.addTo(mask);
+                    for (std::size_t i = 0; i < WORDS; i++) {
+                        _bits[i] &= mask[i];
+                    }
+                }
+                recount();
+            }
+            settle(runs);
+        }
+
+        /** removes the keys in a chunk with the same upper bits */
+        void subtract(const Chunk& other) {
+            bool runs = _kind == RUNS;
+            if (_kind == ARRAY) {
+                std::vector<Low> lows;
+                if (other._kind == ARRAY) {
+                    std::set_difference(_lows.begin(), _lows.end(), other._lows.begin(), other._lows.end(),
+                                        std::back_inserter(lows));
+                } else {
+                    for (Low low : _lows) {
+                        if ( ! other.contains(low)) {
+                            lows.push_back(low);
+                        }
+                    }
+                }
+                _lows.swap(lows);
+                _count = _lows.size();
+            } else {
+                convert(BITMAP);
+                other.removeFrom(_bits);
+                recount();
+            }
+            settle(runs);
+        }
+    };
+
+    std::vector<Low> _highs;     ///< upper 16 bits of the keys in each chunk, sorted
+    std::vector<Chunk> _chunks;  ///< chunks in the same order; none of them empty
+    std::size_t _entryCount;     ///< number of keys
+
+    typedef typename std::make_unsigned<KeyType>::type Unsigned;
+
+    /// flips the sign bit of signed keys, so that unsigned order is key order
+    static std::uint32_t signBit() {
+        return std::is_signed<KeyType>::value ? std::uint32_t(1) << (8 * sizeof(KeyType) - 1) : 0;
+    }
+
+    static std::uint32_t _encode(KeyType key) {
+        return std::uint32_t(Unsigned(key)) ^ signBit();
+    }
+
+    static KeyType _decode(std::uint32_t bits) {
+        return KeyType(Unsigned(bits ^ signBit()));
+    }
+
+public:
+
+    /**  */
+    RoaringBitmap() : _entryCount(0) {}
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    /** iterates keys in order */
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _set || _chunk == _set->_chunks.size()) {
+                throw RoaringBitmapInvalidAccess("next");
+            }
+            const Chunk& c = _set->_chunks[_chunk];
+            switch (c._kind) {
+            case ARRAY:
+                if (++ _index < c._lows.size()) {
+                    _moveTo(c._lows[_index]);
+                    return;
+                }
+                break;
+            case BITMAP:
+                for (std::size_t i = (_low + 1) >> 6; i < WORDS; i++) {
+                    Word w = c._bits[i];
+                    if (i == (_low + 1) >> 6) {
+                        w &= ~Word(0) << ((_low + 1) & 63);
+                    }
+                    if (w) {
+                        _moveTo(i * 64 + _ctz64(w));
+                        return;
+                    }
+                }
+                break;
+            case RUNS:
+                if (_low < c._lows[2 * _index + 1]) {
+                    _moveTo(_low + 1);
+                    return;
+                }
+                if (++ _index < c.runs()) {
+                    _moveTo(c._lows[2 * _index]);
+                    return;
+                }
+                break;
+            }
+            _first(_chunk + 1);
+        }
+
+        const Entry& elem() const {
+            return _entry;
+        }
+
+        const ValueType& value() const {
+            return _entry.second;
+        }
+
+        const KeyType& key() const {
+            return _entry.first;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _chunk == other._chunk && _low == other._low;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return ! (*this == other);
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() : _set(0), _chunk(0), _index(0), _low(0), _entry(KeyType(), EmptyClass()) {}
+
+    protected:
+        friend class RoaringBitmap;
+
+        const RoaringBitmap* _set;
+        std::size_t _chunk;   ///< current chunk; _set->_chunks.size() at the end
+        std::size_t _index;   ///< position in the array, or current run
+        std::uint32_t _low;   ///< lower bits of the current key
+        Entry _entry;         ///< current key
+
+        Iterator(const RoaringBitmap* set, std::size_t chunk)
+            : _set(set), _chunk(chunk), _index(0), _low(0), _entry(KeyType(), EmptyClass()) {
+            _first(chunk);
+        }
+
+        /** moves to the first key of a chunk, or to the end */
+        void _first(std::size_t chunk) {
+            _chunk = chunk;
+            _index = 0;
+            _low = 0;
+            if (chunk < _set->_chunks.size()) {
+                const Chunk& c = _set->_chunks[chunk];
+                if (c._kind == BITMAP) {
+                    std::size_t i = 0;
+                    while ( ! c._bits[i]) {
+                        i++;
+                    }
+                    _moveTo(i * 64 + _ctz64(c._bits[i]));
+                } else {
+                    _moveTo(c._lows[0]);
+                }
+            }
+        }
+
+        void _moveTo(std::uint32_t low) {
+            _low = low;
+            _entry.first = _decode(std::uint32_t(_set->_highs[_chunk]) << 16 | low);
+        }
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** */
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(this, _chunks.size());
+    }
+
+    /** */
+    const Iterator find(const KeyType& key) const {
+        std::uint32_t bits = _encode(key);
+        std::size_t chunk = _chunkFor(bits >> 16);
+        if ( ! _has(chunk, bits >> 16)) {
+            return end();
+        }
+        const Chunk& c = _chunks[chunk];
+        Low low = Low(bits);
+        if ( ! c.contains(low)) {
+            return end();
+        }
+        Iterator it;
+        it._set = this;
+        it._chunk = chunk;
+        if (c._kind == ARRAY) {
+            it._index = std::lower_bound(c._lows.begin(), c._lows.end(), low) - c._lows.begin();
+        } else if (c._kind == RUNS) {
+            it._index = c.runFor(low);
+        }
+        it._moveTo(low);
+        return it;
+    }
+
+    /** */
+    bool contains(const KeyType& key) const {
+        std::uint32_t bits = _encode(key);
+        std::size_t chunk = _chunkFor(bits >> 16);
+        return _has(chunk, bits >> 16) && _chunks[chunk].contains(Low(bits));
+    }
+
+    /** values can only be EmptyClass() */
+    void insert(const KeyType& key, const ValueType& = ValueType()) {
+        std::uint32_t bits = _encode(key);
+        std::size_t chunk = _chunkFor(bits >> 16);
+        if ( ! _has(chunk, bits >> 16)) {
+            _highs.insert(_highs.begin() + chunk, Low(bits >> 16));
+            _chunks.insert(_chunks.begin() + chunk, Chunk());
+        }
+        if (_chunks[chunk].insert(Low(bits))) {
+            _entryCount ++;
+        }
+    }
+
+    /** */
+    void erase(const KeyType& key) {
+        std::uint32_t bits = _encode(key);
+        std::size_t chunk = _chunkFor(bits >> 16);
+        if ( ! _has(chunk, bits >> 16) || ! _chunks[chunk].erase(Low(bits))) {
+            throw RoaringBitmapNoSuchElement("erase");
+        }
+        if ( ! _chunks[chunk]._count) {
+            _highs.erase(_highs.begin() + chunk);
+            _chunks.erase(_chunks.begin() + chunk);
+        }
+        _entryCount --;
+    }
+
+    /** adds the keys of other */
+    void union_with(const RoaringBitmap& other) {
+        if (&other == this) {
+            return;
+        }
+        RoaringBitmap result;
+        std::size_t i = 0, j = 0;
+        while (i < _chunks.size() || j < other._chunks.size()) {
+            if (j == other._chunks.size() || (i < _chunks.size() && _highs[i] < other._highs[j])) {
+                result._append(_highs[i], std::move(_chunks[i]));
+                i++;
+            } else if (i == _chunks.size() || other._highs[j] < _highs[i]) {
+                result._append(other._highs[j], Chunk(other._chunks[j]));
+                j++;
+            } else {
+                _chunks[i].unite(other._chunks[j++]);
+                result._append(_highs[i], std::move(_chunks[i]));
+                i++;
+            }
+        }
+        *this = std::move(result);
+    }
+
+    /** keeps the keys that are also in other */
+    void intersect_with(const RoaringBitmap& other) {
+        if (&other == this) {
+            return;
+        }
+        RoaringBitmap result;
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < _chunks.size(); i++) {
+            while (j < other._chunks.size() && other._highs[j] < _highs[i]) {
+                j++;
+            }
+            if (other._has(j, _highs[i])) {
+                _chunks[i].intersect(other._chunks[j]);
+                result._append(_highs[i], std::move(_chunks[i]));
+            }
+        }
+        *this = std::move(result);
+    }
+
+    /** removes the keys that are in other */
+    void difference_with(const RoaringBitmap& other) {
+        if (&other == this) {
+            *this = RoaringBitmap();
+            return;
+        }
+        RoaringBitmap result;
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < _chunks.size(); i++) {
+            while (j < other._chunks.size() && other._highs[j] < _highs[i]) {
+                j++;
+            }
+            if (other._has(j, _highs[i])) {
+                _chunks[i].subtract(other._chunks[j]);
+            }
+            result._append(_highs[i], std::move(_chunks[i]));
+        }
+        *this = std::move(result);
+    }
+
+    /**
+     * Keeps each chunk as runs wherever that takes less space than an
+     * array or a bitmap, and frees unused capacity. Best called once
+     * a bitmap is built; O(N)
+     */
+    void optimize() {
+        for (Chunk& c : _chunks) {
+            c.settle(true);
+            c._lows.shrink_to_fit();
+        }
+        _highs.shrink_to_fit();
+        _chunks.shrink_to_fit();
+    }
+
+    /** bytes taken by the bitmap and its chunks, not counting allocator overhead */
+    std::size_t bytes() const {
+        std::size_t bytes = sizeof(*this) + _highs.capacity() * sizeof(Low)
+            + _chunks.capacity() * sizeof(Chunk);
+        for (const Chunk& c : _chunks) {
+            bytes += c._lows.capacity() * sizeof(Low) + c._bits.capacity() * sizeof(Word);
+        }
+        return bytes;
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (Iterator it = begin(); it != end(); it.next()) {
+            out << it.key() << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        std::size_t kinds[3] = { 0, 0, 0 };
+        for (const Chunk& c : _chunks) {
+            kinds[c._kind] ++;
+        }
+        out << "total of " << _entryCount << " keys in " << _chunks.size() << " chunks ("
+            << kinds[ARRAY] << " arrays, " << kinds[BITMAP] << " bitmaps, " << kinds[RUNS]
+            << " runs); " << bytes() << " bytes" << std::endl;
+    }
+
+private:
+
+    /** index of the first chunk with upper bits not less than high */
+    std::size_t _chunkFor(std::uint32_t high) const {
+        return std::lower_bound(_highs.begin(), _highs.end(), high) - _highs.begin();
+    }
+
+    /** whether the chunk at that index has those upper bits */
+    bool _has(std::size_t chunk, std::uint32_t high) const {
+        return chunk < _highs.size() && _highs[chunk] == high;
+    }
+
+    /** adds a chunk after all others, and its keys to the count, unless empty */
+    void _append(Low high, Chunk&& chunk) {
+        if (chunk._count) {
+            _entryCount += chunk._count;
+            _highs.push_back(high);
+            _chunks.push_back(std::move(chunk));
+        }
+    }
+};
+
+#endif // __ROARINGBITMAP_H
@@ -17,16 +17,128 @@
 
 #include "HashTable.h"
 #include "TreeMap.h"
+#include "BPlusTreeMap.h"
+#include "SplayTreeMap.h"
+#include "RoaringBitmap.h"
+#include "MultiMap.h"
 
-struct EmptyClass {};
-/// std::ostream output
-std::ostream& operator<<(std::ostream& out, const EmptyClass &e) {
-    return out;
+#include <vector>
+#include <future>
+#include <type_traits>
+
+/**
+ * Tells how sets kept in a container are combined (see set_union and
+ * friends). Containers that iterate in key order, as most do, are
+ * merged in a single pass over both sets; others are combined by
+ * walking one set (the smaller, where possible) and looking up its
+ * elements in the other. Key order is that of BaseSet::key_less: the
+ * Compare of a TreeMap, and operator< for any other container.
+ *
+ * Multisets (multi) keep copies of their keys, which set algebra does
+ * not account for; combining them does not compile.
+ */
+template <template<typename,typename> class Container>
+struct SetTraits {
+    typedef std::true_type ordered;
+    typedef std::false_type multi;
+};
+
+/** hash tables iterate in no particular order */
+template <>
+struct SetTraits<HashTable> {
+    typedef std::false_type ordered;
+    typedef std::false_type multi;
+};
+
+/** nor do filtered hash tables */
+template <>
+struct SetTraits<FilteredHashTable> {
+    typedef std::false_type ordered;
+    typedef std::false_type multi;
+};
+
+/** neither do hash multisets (set algebra is not defined for multisets) */
+template <>
+struct SetTraits<HashMultiMap> {
+    typedef std::false_type ordered;
+    typedef std::true_type multi;
+};
+
+/** tree multisets are ordered (but set algebra is not defined for multisets either) */
+template <>
+struct SetTraits<TreeMultiMap> {
+    typedef std::true_type ordered;
+    typedef std::true_type multi;
+};
+
+namespace util
+{
+    /**
+     * Walks two sets that iterate in key order at once, calling
+     * visit(key, inA, inB) for each element of either, in order,
+     * until it returns false.
+     * @return false if visit did
+     */
+    template<typename S, typename Visit>
+    bool merge_sets(const S& a, const S& b, Visit visit)
+    {
+        auto i = a.begin(), j = b.begin();
+        while (i != a.end() || j != b.end())
+        {
+            bool more;
+            if (j == b.end() || (i != a.end() && a.key_less(i.key(), j.key())))
+            {
+                more = visit(i.key(), true, false);
+                i.next();
+            }
+            else if (i == a.end() || a.key_less(j.key(), i.key()))
+            {
+                more = visit(j.key(), false, true);
+                j.next();
+            }
+            else
+            {
+                more = visit(i.key(), true, true);
+                i.next();
+                j.next();
+            }
+            if (!more)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Looks up each of the keys in a set, splitting them between up to
+     * threads threads when there are more than grain keys per thread.
+     * @return whether each key is in the set, in the same order
+     */
+    template<typename S, typename K>
+    std::vector<char> contained_in(const S& set, const std::vector<K>& keys,
+                                   unsigned threads, std::size_t grain)
+    {
+        std::vector<char> found(keys.size());
+        auto probe = [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+                found[i] = set.contains(keys[i]);
+        };
+        std::size_t chunks = std::min<std::size_t>(threads ? threads : 1, keys.size() / grain + 1);
+        std::vector<std::future<void>> forked;
+        for (std::size_t c = 1; c < chunks; ++c)
+            forked.push_back(std::async(std::launch::async, probe,
+                c * keys.size() / chunks, (c + 1) * keys.size() / chunks));
+        probe(0, keys.size() / chunks);
+        for (auto& f : forked)
+            f.get();
+        return found;
+    }
 }
-    
+
 /**
  * Sets allow quick insertion, lookup and removal of elements.
- * Duplicate insertions are ignored.
+ * Duplicate insertions are ignored, except in multisets (Set::MH and
+ * Set::MT), which keep every copy; set algebra does not compile for those.
  * 
  * Built on top of an associative container.
  * 
@@ -63,6 +175,11 @@ public:
         return _m.find(key) != _m.end();
     }
     
+    /** how many times the key is in the set: 0 or 1, except in multisets */
+    std::size_t count(const KeyType& key) const {
+        return _count(_m, key);
+    }
+
     /**  */
     void insert(const KeyType& key) {
         _m.insert(key, EmptyClass());
@@ -77,17 +194,457 @@ public:
     std::size_t size() const {
         return _m.size();
     }
+
+    /**
+     * Whether a comes before b when iterating an ordered set: by the
+     * Compare of Set::T and other TreeMap-backed sets; by operator<
+     * for the rest
+     */
+    bool key_less(const KeyType& a, const KeyType& b) const {
+        return _keyLess(_m, a, b);
+    }
+
+    /// keys in a set this small are never looked up from several threads
+    static const std::size_t PARALLEL_GRAIN = 1 << 14;
+
+    /** 
+     * Builds a set from a range of strictly increasing keys. O(N) for
+     * Set::T; other sets insert them one by one
+     */
+    template <class It>
+    static BaseSet from_sorted(It first, It last) {
+        BaseSet set;
+        _fromSorted(set._m, first, last);
+        return set;
+    }
+
+    /** the elements of the set, in iteration order */
+    std::vector<KeyType> keys() const {
+        std::vector<KeyType> keys;
+        keys.reserve(size());
+        for (Iterator it = begin(); it != end(); it.next()) {
+            keys.push_back(it.key());
+        }
+        return keys;
+    }
+
+    /**
+     * Adds the elements of other. Set::T splits and joins trees, in
+     * parallel with up to the given number of threads (see 
+     * TreeMap::union_with); other ordered sets are merged, and hash 
+     * sets insert the elements of the smaller set into a copy of the larger
+     */
+    void union_with(const BaseSet& other, unsigned threads = 1) {
+        static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+        _unionWith(_m, other, threads);
+    }
+
+    /**
+     * Keeps the elements that are also in other. As union_with; hash
+     * sets look up the elements of the smaller set in the larger, from
+     * several threads if there are enough of them
+     */
+    void intersect_with(const BaseSet& other, unsigned threads = 1) {
+        static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+        _intersectWith(_m, other, threads);
+    }
+
+    /** Removes the elements that are in other. As intersect_with */
+    void difference_with(const BaseSet& other, unsigned threads = 1) {
+        static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+        _differenceWith(_m, other, threads);
+    }
+
+private:
+
+    typedef typename SetTraits<Container>::ordered Ordered;
+
+    template <class K, class C, class It>
+    static void _fromSorted(TreeMap<K, EmptyClass, C>& m, It first, It last) {
+        std::vector<std::pair<K, EmptyClass>> entries;
+        for (; first != last; ++first) {
+            entries.push_back(std::make_pair(*first, EmptyClass()));
+        }
+        m = TreeMap<K, EmptyClass, C>::from_sorted(entries.begin(), entries.end());
+    }
+
+    template <class M, class It>
+    static void _fromSorted(M& m, It first, It last) {
+        for (; first != last; ++first) {
+            m.insert(*first, EmptyClass());
+        }
+    }
+
+    /* TreeMaps iterate in the order of their Compare; other ordered containers, in operator< order */
+
+    template <class K, class C>
+    static bool _keyLess(const TreeMap<K, EmptyClass, C>& m, const KeyType& a, const KeyType& b) {
+        return m.key_comp()(a, b);
+    }
+
+    template <class M>
+    static bool _keyLess(const M&, const KeyType& a, const KeyType& b) {
+        return a < b;
+    }
+
+    /* multisets count the copies of a key; other sets look it up */
+
+    template <class K, template<typename,typename> class C>
+    static std::size_t _count(const MultiMap<K, EmptyClass, C>& m, const KeyType& key) {
+        return m.count(key);
+    }
+
+    template <class M>
+    static std::size_t _count(const M& m, const KeyType& key) {
+        return m.find(key) != m.end() ? 1 : 0;
+    }
+
+    /* Set::T uses the join-based operations of TreeMap */
+
+    template <class K, class C>
+    void _unionWith(TreeMap<K, EmptyClass, C>& m, const BaseSet& other, unsigned threads) {
+        m.union_with(other._m, threads);
+    }
+
+    template <class K, class C>
+    void _intersectWith(TreeMap<K, EmptyClass, C>& m, const BaseSet& other, unsigned threads) {
+        m.intersect_with(other._m, threads);
+    }
+
+    template <class K, class C>
+    void _differenceWith(TreeMap<K, EmptyClass, C>& m, const BaseSet& other, unsigned threads) {
+        m.difference_with(other._m, threads);
+    }
+
+    /* Set::R combines whole chunks of its bitmaps */
+
+    template <class K>
+    void _unionWith(RoaringBitmap<K, EmptyClass>& m, const BaseSet& other, unsigned) {
+        m.union_with(other._m);
+    }
+
+    template <class K>
+    void _intersectWith(RoaringBitmap<K, EmptyClass>& m, const BaseSet& other, unsigned) {
+        m.intersect_with(other._m);
+    }
+
+    template <class K>
+    void _differenceWith(RoaringBitmap<K, EmptyClass>& m, const BaseSet& other, unsigned) {
+        m.difference_with(other._m);
+    }
+
+    /* Other ordered sets are merged into a new set */
+
+    template <class M>
+    void _unionWith(M&, const BaseSet& other, unsigned threads) {
+        _unionWith(other, threads, Ordered());
+    }
+
+    template <class M>
+    void _intersectWith(M&, const BaseSet& other, unsigned threads) {
+        _intersectWith(other, threads, Ordered());
+    }
+
+    template <class M>
+    void _differenceWith(M&, const BaseSet& other, unsigned threads) {
+        _differenceWith(other, threads, Ordered());
+    }
+
+    void _unionWith(const BaseSet& other, unsigned threads, std::true_type) {
+        *this = set_union(*this, other, threads);
+    }
+
+    void _intersectWith(const BaseSet& other, unsigned threads, std::true_type) {
+        *this = set_intersection(*this, other, threads);
+    }
+
+    void _differenceWith(const BaseSet& other, unsigned threads, std::true_type) {
+        *this = set_difference(*this, other, threads);
+    }
+
+    /* Hash sets walk the smaller set and probe the larger */
+
+    void _unionWith(const BaseSet& other, unsigned threads, std::false_type) {
+        if (other.size() > size()) {
+            *this = set_union(*this, other, threads);
+        } else if (&other != this) {
+            for (Iterator it = other.begin(); it != other.end(); it.next()) {
+                insert(it.key());
+            }
+        }
+    }
+
+    void _intersectWith(const BaseSet& other, unsigned threads, std::false_type) {
+        if (other.size() < size()) {
+            *this = set_intersection(*this, other, threads);
+            return;
+        }
+        std::vector<KeyType> keys = this->keys();
+        std::vector<char> found = util::contained_in(other, keys, threads, PARALLEL_GRAIN);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            if ( ! found[i]) {
+                erase(keys[i]);
+            }
+        }
+    }
+
+    void _differenceWith(const BaseSet& other, unsigned threads, std::false_type) {
+        std::vector<KeyType> keys = other.size() < size() ? other.keys() : this->keys();
+        std::vector<char> found = util::contained_in(other.size() < size() ? *this : other, 
+                                                     keys, threads, PARALLEL_GRAIN);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            if (found[i]) {
+                erase(keys[i]);
+            }
+        }
+    }
 };
 
 /**
- * Pre-built sets using a HashTable and a TreeMap as backup containers
+ * Elements in a, or b, or both. Ordered sets are merged in O(N + M);
+ * hash sets copy the larger and add the elements of the smaller
+ */
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_union(const BaseSet<KeyType, Container>& a, 
+                                      const BaseSet<KeyType, Container>& b, unsigned threads = 1);
+
+/**
+ * Elements in both a and b. Ordered sets are merged in O(N + M), unless
+ * one is much smaller: then, as always for hash sets, the elements of
+ * the smaller set are looked up in the larger. Hash sets do so in
+ * parallel, with up to the given number of threads, if there are enough
+ */
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_intersection(const BaseSet<KeyType, Container>& a, 
+                                             const BaseSet<KeyType, Container>& b, unsigned threads = 1);
+
+/** Elements in a but not in b. As set_intersection */
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_difference(const BaseSet<KeyType, Container>& a, 
+                                           const BaseSet<KeyType, Container>& b, unsigned threads = 1);
+
+/** Whether every element of a is in b. As set_intersection, but stops at the first one missing */
+template <class KeyType, template<typename,typename> class Container>
+bool is_subset(const BaseSet<KeyType, Container>& a, 
+               const BaseSet<KeyType, Container>& b, unsigned threads = 1);
+
+namespace util
+{
+    /**
+     * Whether looking up each of m elements in an ordered set of n, in
+     * O(m log n), beats merging both sets in O(n + m)
+     */
+    inline bool few_against_many(std::size_t m, std::size_t n)
+    {
+        std::size_t log = 1;
+        while ((std::size_t(1) << log) < n)
+            ++log;
+        return m * log < n;
+    }
+
+    /** the elements of walked that are (or are not, if !found) in probed, in iteration order */
+    template<typename S>
+    auto probed(const S& walked, const S& probed, bool found, unsigned threads)
+        -> decltype(walked.keys())
+    {
+        auto keys = walked.keys();
+        std::vector<char> in = contained_in(probed, keys, threads, S::PARALLEL_GRAIN);
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < keys.size(); ++i)
+            if (bool(in[i]) == found)
+                keys[kept++] = keys[i];
+        keys.resize(kept);
+        return keys;
+    }
+
+    /** the elements of a merge of two ordered sets that keep says to keep */
+    template<typename S, typename Keep>
+    S merged(const S& a, const S& b, Keep keep)
+    {
+        typedef typename std::decay<decltype(a.begin().key())>::type K;
+        std::vector<K> kept;
+        merge_sets(a, b, [&](const K& key, bool inA, bool inB)
+        {
+            if (keep(inA, inB))
+                kept.push_back(key);
+            return true;
+        });
+        return S::from_sorted(kept.begin(), kept.end());
+    }
+
+    /* Set::R copies one set and combines it with the other in place */
+
+    template<typename K>
+    BaseSet<K, RoaringBitmap> set_union(const BaseSet<K, RoaringBitmap>& a,
+                                        const BaseSet<K, RoaringBitmap>& b, unsigned, std::true_type)
+    {
+        BaseSet<K, RoaringBitmap> result(a);
+        result.union_with(b);
+        return result;
+    }
+
+    template<typename K>
+    BaseSet<K, RoaringBitmap> set_intersection(const BaseSet<K, RoaringBitmap>& a,
+                                               const BaseSet<K, RoaringBitmap>& b, unsigned, std::true_type)
+    {
+        BaseSet<K, RoaringBitmap> result(a);
+        result.intersect_with(b);
+        return result;
+    }
+
+    template<typename K>
+    BaseSet<K, RoaringBitmap> set_difference(const BaseSet<K, RoaringBitmap>& a,
+                                             const BaseSet<K, RoaringBitmap>& b, unsigned, std::true_type)
+    {
+        BaseSet<K, RoaringBitmap> result(a);
+        result.difference_with(b);
+        return result;
+    }
+
+    template<typename K>
+    bool is_subset(const BaseSet<K, RoaringBitmap>& a, const BaseSet<K, RoaringBitmap>& b,
+                   unsigned threads, std::true_type)
+    {
+        return a.size() <= b.size() && set_difference(a, b, threads, std::true_type()).size() == 0;
+    }
+
+    template<typename S>
+    S set_union(const S& a, const S& b, unsigned, std::true_type)
+    {
+        return merged(a, b, [](bool, bool) { return true; });
+    }
+
+    template<typename S>
+    S set_union(const S& a, const S& b, unsigned, std::false_type)
+    {
+        const S& smaller = a.size() < b.size() ? a : b;
+        S result(&smaller == &a ? b : a);
+        for (auto it = smaller.begin(); it != smaller.end(); it.next())
+            result.insert(it.key());
+        return result;
+    }
+
+    // ordered sets are only looked up from one thread: splay trees change on lookups
+
+    template<typename S>
+    S set_intersection(const S& a, const S& b, unsigned, std::true_type)
+    {
+        const S& smaller = a.size() < b.size() ? a : b;
+        const S& larger = &smaller == &a ? b : a;
+        if (few_against_many(smaller.size(), larger.size()))
+        {
+            auto kept = probed(smaller, larger, true, 1);
+            return S::from_sorted(kept.begin(), kept.end());
+        }
+        return merged(a, b, [](bool inA, bool inB) { return inA && inB; });
+    }
+
+    template<typename S>
+    S set_intersection(const S& a, const S& b, unsigned threads, std::false_type)
+    {
+        const S& smaller = a.size() < b.size() ? a : b;
+        S result;
+        for (const auto& key : probed(smaller, &smaller == &a ? b : a, true, threads))
+            result.insert(key);
+        return result;
+    }
+
+    template<typename S>
+    S set_difference(const S& a, const S& b, unsigned, std::true_type)
+    {
+        if (few_against_many(a.size(), b.size()))
+        {
+            auto kept = probed(a, b, false, 1);
+            return S::from_sorted(kept.begin(), kept.end());
+        }
+        return merged(a, b, [](bool inA, bool inB) { return inA && !inB; });
+    }
+
+    template<typename S>
+    S set_difference(const S& a, const S& b, unsigned threads, std::false_type)
+    {
+        S result;
+        for (const auto& key : probed(a, b, false, threads))
+            result.insert(key);
+        return result;
+    }
+
+    template<typename S>
+    bool is_subset(const S& a, const S& b, unsigned, std::true_type)
+    {
+        typedef typename std::decay<decltype(a.begin().key())>::type K;
+        if (a.size() > b.size())
+            return false;
+        if (few_against_many(a.size(), b.size()))
+        {
+            for (auto it = a.begin(); it != a.end(); it.next())
+                if (!b.contains(it.key()))
+                    return false;
+            return true;
+        }
+        return merge_sets(a, b, [](const K&, bool, bool inB) { return inB; });
+    }
+
+    template<typename S>
+    bool is_subset(const S& a, const S& b, unsigned threads, std::false_type)
+    {
+        if (a.size() > b.size())
+            return false;
+        std::vector<char> found = contained_in(b, a.keys(), threads, S::PARALLEL_GRAIN);
+        return std::find(found.begin(), found.end(), 0) == found.end();
+    }
+}
+
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_union(const BaseSet<KeyType, Container>& a, 
+                                      const BaseSet<KeyType, Container>& b, unsigned threads) {
+    static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+    return util::set_union(a, b, threads, typename SetTraits<Container>::ordered());
+}
+
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_intersection(const BaseSet<KeyType, Container>& a, 
+                                             const BaseSet<KeyType, Container>& b, unsigned threads) {
+    static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+    return util::set_intersection(a, b, threads, typename SetTraits<Container>::ordered());
+}
+
+template <class KeyType, template<typename,typename> class Container>
+BaseSet<KeyType, Container> set_difference(const BaseSet<KeyType, Container>& a, 
+                                           const BaseSet<KeyType, Container>& b, unsigned threads) {
+    static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+    return util::set_difference(a, b, threads, typename SetTraits<Container>::ordered());
+}
+
+template <class KeyType, template<typename,typename> class Container>
+bool is_subset(const BaseSet<KeyType, Container>& a, 
+               const BaseSet<KeyType, Container>& b, unsigned threads) {
+    static_assert( ! SetTraits<Container>::multi::value, "set algebra is not defined for multisets");
+    return util::is_subset(a, b, threads, typename SetTraits<Container>::ordered());
+}
+
+/**
+ * Pre-built sets using a HashTable, a TreeMap, a BPlusTreeMap and a SplayTreeMap as backup containers
  */
 template <class KeyType>
 struct Set {
     /// Set::H is a HashTable-backed set, and is not ordered
     typedef BaseSet<KeyType, HashTable> H;
+    /// Set::HF is Set::H with a Bloom filter in front; best when most lookups miss
+    typedef BaseSet<KeyType, FilteredHashTable> HF;
     /// Set::M is a TreeMap-backed set, and is always ordered
-    typedef BaseSet<KeyType, TreeMap> T;    
+    typedef BaseSet<KeyType, DefaultTreeMap> T;    
+    /// Set::B is a BPlusTreeMap-backed set, and is always ordered
+    typedef BaseSet<KeyType, DefaultBPlusTreeMap> B;
+    /// Set::S is a SplayTreeMap-backed set, and is always ordered; best when few keys get most lookups
+    typedef BaseSet<KeyType, SplayTreeMap> S;
+    /// Set::R is a RoaringBitmap-backed set of integers, and is always ordered; best for many, dense keys
+    typedef BaseSet<KeyType, RoaringBitmap> R;
+    /// Set::MH is a HashMultiMap-backed multiset, and is not ordered; erase removes every copy of a key
+    typedef BaseSet<KeyType, HashMultiMap> MH;
+    /// Set::MT is a TreeMultiMap-backed multiset, and is always ordered; erase removes every copy of a key.
+    /// Set algebra (set_union and friends, union_with and friends) does not compile for MH nor MT
+    typedef BaseSet<KeyType, TreeMultiMap> MT;
 };
 
 #if __cplusplus >= 201103L //C++11
@@ -0,0 +1,322 @@
+/**
+ * @file SplayTreeMap.h
+ *
+ * A map implemented using a splay tree: recently used keys are kept
+ * near the root. Similar to std::map
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __SPLAYTREEMAP_H
+#define __SPLAYTREEMAP_H
+
+#include "Util.h"
+#include "BinTree.h"
+
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(SplayTreeMapNoSuchElement)
+DECLARE_EXCEPTION(SplayTreeMapInvalidAccess)
+
+/**
+ * A map implemented using a splay tree. Every find, insert and erase
+ * splays (top-down) the key it looks for to the root, so keys that are
+ * used over and over stay a few steps away from it; lookups, insertions
+ * and removals take O(log N) amortized time, and much less when a small
+ * set of keys gets most of the accesses. A single operation can take
+ * O(N), though, and even lookups restructure the tree.
+ *
+ * Splaying never changes the order of entries, so iterators remain
+ * valid after lookups and insertions; and after removals, unless their
+ * entry is the one removed. The heights and counts of BinTree nodes are
+ * not maintained.
+ */
+template <class KeyType, class ValueType>
+class SplayTreeMap{
+private:
+    typedef std::pair<const KeyType, ValueType> Entry;
+    typedef BinTree<Entry> Tree;
+    typedef typename Tree::Node Node;
+
+    /// splay tree; mutable because lookups splay it
+    mutable Tree _t;
+    std::size_t _entryCount;  ///< number of key-value entries in tree
+
+public:
+
+    /**  */
+    SplayTreeMap() : _t(), _entryCount(0) {}
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _current) {
+                throw SplayTreeMapInvalidAccess("next");
+            }
+            _current = Tree::nextInOrder(_current);
+        }
+
+        void prev() {
+            Node *prev = _current ?
+                Tree::prevInOrder(_current) : Tree::lastInOrder(_tree->_root);
+            if ( ! prev) {
+                throw SplayTreeMapInvalidAccess("prev");
+            }
+            _current = prev;
+        }
+
+        const Entry& elem() const {
+            return _current->_elem;
+        }
+
+        Entry& elem() {
+            return _current->_elem;
+        }
+
+        const ValueType& value() const {
+            return _current->_elem.second;
+        }
+
+        const KeyType& key() const {
+            return _current->_elem.first;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class SplayTreeMap;
+
+        /** current node, 0 at the end */
+        Node* _current;
+
+        /** tree being iterated; needed to go back from the end */
+        const Tree* _tree;
+
+        /** */
+        Iterator(const Tree* tree, Node* current)
+            : _current(current), _tree(tree) {}
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** splays the key (or its closest neighbour) to the root */
+    const Iterator find(const KeyType& key) const {
+        return Iterator(&_t, _find(key));
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(&_t, Tree::firstInOrder(_t._root));
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(&_t, 0);
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        Node *n = _find(key);
+        if ( ! n) {
+            throw SplayTreeMapNoSuchElement("at");
+        }
+        return n->_elem.second;
+    }
+
+    /** */
+    ValueType& at(const KeyType& key) {
+        NON_CONST_VARIANT(ValueType,SplayTreeMap,at(key));
+    }
+
+    /**
+     * Splays the key to the root and, if it was not there,
+     * makes a new root with the tree split around it
+     */
+    void insert(const KeyType& key, const ValueType& value) {
+        Node *root = _splay(_t._root, key);
+        if (root && ! (key < root->_elem.first) && ! (root->_elem.first < key)) {
+            root->_elem.second = value;
+            _t._root = root;
+            return;
+        }
+        Node *n = _t.createNode(Entry(key, value));
+        if (root && key < root->_elem.first) {
+            Tree::setLeft(n, root->_left);
+            root->_left = 0;
+            Tree::setRight(n, root);
+        } else if (root) {
+            Tree::setRight(n, root->_right);
+            root->_right = 0;
+            Tree::setLeft(n, root);
+        }
+        _t._root = n;
+        _entryCount ++;
+    }
+
+    /**
+     * Splays the key to the root and joins its subtrees, splaying the
+     * largest key of the left one to its root
+     */
+    void erase(const KeyType& key) {
+        Node *root = _splay(_t._root, key);
+        _t._root = root;
+        if ( ! root || key < root->_elem.first || root->_elem.first < key) {
+            throw SplayTreeMapNoSuchElement("erase");
+        }
+        Node *left = root->_left, *right = root->_right;
+        if (left) {
+            left->_parent = 0;
+            // every key on the left is smaller, so its largest ends up on top with no right child
+            left = _splay(left, key);
+            Tree::setRight(left, right);
+        } else {
+            left = right;
+        }
+        if (left) {
+            left->_parent = 0;
+        }
+        root->_left = root->_right = 0;
+        _t.deleteNode(root);
+        _t._root = left;
+        _entryCount --;
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) {
+        _t.print(_t._root, out);
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) {
+        std::size_t totalDepth = 0, max = 0, depth = 1;
+        Node *n = _t._root;
+        for (; n && n->_left; n = n->_left) {
+            depth ++;
+        }
+        // in-order walk, keeping track of the depth of each node
+        while (n) {
+            totalDepth += depth;
+            max = depth > max ? depth : max;
+            if (n->_right) {
+                for (n = n->_right, depth ++; n->_left; n = n->_left) {
+                    depth ++;
+                }
+            } else {
+                while (n->_parent && n == n->_parent->_right) {
+                    n = n->_parent;
+                    depth --;
+                }
+                n = n->_parent;
+                depth --;
+            }
+        }
+        out << "total of " << _entryCount
+             << " nodes; avg path length is " << (_entryCount ? (float)totalDepth / _entryCount : 0.0f)
+             << " max is " << max
+             << std::endl;
+    }
+
+private:
+
+    /** splays the key to the root; returns its node, 0 if not found */
+    Node *_find(const KeyType& key) const {
+        _t._root = _splay(_t._root, key);
+        Node *root = _t._root;
+        return root && ! (key < root->_elem.first) && ! (root->_elem.first < key) ? root : 0;
+    }
+
+    /**
+     * Top-down splay: walks down from n towards the key, two levels at
+     * a time, rotating zig-zig steps (without updating heights or counts)
+     * and setting aside the subtrees left behind: those with smaller keys
+     * in a left tree, those with larger keys in a right tree. The last
+     * node reached (the key, or the last one before falling off the tree)
+     * becomes the root, with the left and right trees as its children.
+     * @param n root of the subtree to splay
+     * @return the new root
+     */
+    static Node *_splay(Node *n, const KeyType& key) {
+        if ( ! n) {
+            return n;
+        }
+        Node *left = 0, *leftMax = 0;   // left tree, and its node with the largest key
+        Node *right = 0, *rightMin = 0; // right tree, and its node with the smallest key
+        for (;;) {
+            if (key < n->_elem.first) {
+                if ( ! n->_left) {
+                    break;
+                } else if (key < n->_left->_elem.first) {
+                    Node *l = n->_left;
+                    Tree::setLeft(n, l->_right);
+                    Tree::setRight(l, n);
+                    n = l;
+                    if ( ! n->_left) {
+                        break;
+                    }
+                }
+                // n and its right subtree go to the right tree
+                if (rightMin) {
+                    Tree::setLeft(rightMin, n);
+                } else {
+                    right = n;
+                }
+                rightMin = n;
+                n = n->_left;
+            } else if (n->_elem.first < key) {
+                if ( ! n->_right) {
+                    break;
+                } else if (n->_right->_elem.first < key) {
+                    Node *r = n->_right;
+                    Tree::setRight(n, r->_left);
+                    Tree::setLeft(r, n);
+                    n = r;
+                    if ( ! n->_right) {
+                        break;
+                    }
+                }
+                // n and its left subtree go to the left tree
+                if (leftMax) {
+                    Tree::setRight(leftMax, n);
+                } else {
+                    left = n;
+                }
+                leftMax = n;
+                n = n->_right;
+            } else {
+                break;
+            }
+        }
+        if (leftMax) {
+            Tree::setRight(leftMax, n->_left);
+            Tree::setLeft(n, left);
+        }
+        if (rightMin) {
+            Tree::setLeft(rightMin, n->_right);
+            Tree::setRight(n, right);
+        }
+        n->_parent = 0;
+        return n;
+    }
+};
+
+#endif // __SPLAYTREEMAP_H
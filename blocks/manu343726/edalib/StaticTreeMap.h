@@ -0,0 +1,319 @@
+/**
+ * @file StaticTreeMap.h
+ *
+ * A read-only map stored as an implicit search tree in a single array,
+ * in Eytzinger (breadth-first) order. Built from a TreeMap (or any
+ * sorted sequence) when a map stops changing and only lookups remain.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef __STATICTREEMAP_H
+#define __STATICTREEMAP_H
+
+#include "Util.h"
+#include "TreeMap.h"
+
+#include <iterator>
+#include <memory>  //std::align
+#include <new>
+#include <utility> //std::pair<const key,value> instead of custom pair class
+
+DECLARE_EXCEPTION(StaticTreeMapNoSuchElement)
+DECLARE_EXCEPTION(StaticTreeMapInvalidAccess)
+
+/**
+ * A read-only map stored as an implicit, perfectly balanced search tree.
+ * Keys are kept in one array in Eytzinger order: the root at index 1,
+ * and the children of index i at 2i and 2i+1. There are no pointers to
+ * chase, the top levels of the tree share a few cache lines, and a
+ * lookup is a branchless descent that prefetches the cache line holding
+ * the descendants four levels below (for 4-byte keys) while comparing.
+ *
+ * Lookups are O(log N). Building one takes O(N) from a TreeMap or from
+ * any sequence sorted by strictly increasing key; it cannot be modified
+ * afterwards. Values are kept apart from keys, so lookups touch keys
+ * only. Keys and values must be default-constructible and assignable,
+ * and Iterator::elem() returns entries by value.
+ */
+template <class KeyType, class ValueType>
+class StaticTreeMap{
+private:
+    typedef std::pair<const KeyType, ValueType> Entry;
+
+    /// size assumed for cache lines
+    static const std::size_t CACHE_LINE = 64;
+
+    /// keys per cache line; index i*KEYS_PER_LINE is where the descendants of i lie, log2(KEYS_PER_LINE) levels below
+    static const std::size_t KEYS_PER_LINE =
+        sizeof(KeyType) < CACHE_LINE ? CACHE_LINE / sizeof(KeyType) : 1;
+
+    KeyType* _keys;          ///< keys in Eytzinger order, from index 1; cache-line aligned
+    char* _keyStorage;       ///< storage that _keys lives in
+    ValueType* _values;      ///< _values[i] is the value of _keys[i]
+    std::size_t _entryCount; ///< number of key-value entries
+
+public:
+
+    /**  */
+    StaticTreeMap() : _keys(0), _keyStorage(0), _values(0), _entryCount(0) {}
+
+    /** freezes the current contents of a TreeMap */
+    explicit StaticTreeMap(const TreeMap<KeyType, ValueType>& map)
+        : _keys(0), _keyStorage(0), _values(0), _entryCount(0) {
+        _allocate(map.size());
+        std::size_t i = _first();
+        for (auto it = map.begin(); it != map.end(); it.next(), i = _next(i)) {
+            _keys[i] = it.key();
+            _values[i] = it.value();
+        }
+    }
+
+    /**
+     * Builds a StaticTreeMap from a range of key-value pairs sorted by
+     * strictly increasing key (as those of a std::map), in O(N).
+     */
+    template <class It>
+    static StaticTreeMap from_sorted(It first, It last) {
+        StaticTreeMap map;
+        map._allocate(std::distance(first, last));
+        for (std::size_t i = map._first(); first != last; ++ first, i = map._next(i)) {
+            map._keys[i] = first->first;
+            map._values[i] = first->second;
+        }
+        return map;
+    }
+
+    /**  */
+    StaticTreeMap(const StaticTreeMap& other)
+        : _keys(0), _keyStorage(0), _values(0), _entryCount(0) {
+        _allocate(other._entryCount);
+        for (std::size_t i = 1; i <= _entryCount; i++) {
+            _keys[i] = other._keys[i];
+            _values[i] = other._values[i];
+        }
+    }
+
+    /**  */
+    StaticTreeMap(StaticTreeMap&& other)
+        : _keys(0), _keyStorage(0), _values(0), _entryCount(0) {
+        _swap(other);
+    }
+
+    /**  */
+    ~StaticTreeMap() {
+        _free();
+    }
+
+    /**  */
+    StaticTreeMap& operator=(StaticTreeMap other) {
+        _swap(other);
+        return *this;
+    }
+
+    /**  */
+    std::size_t size() const {
+        return _entryCount;
+    }
+
+    class Iterator{
+    public:
+        void next() {
+            if ( ! _index) {
+                throw StaticTreeMapInvalidAccess("next");
+            }
+            _index = _map->_next(_index);
+        }
+
+        Entry elem() const {
+            return Entry(key(), value());
+        }
+
+        const ValueType& value() const {
+            return _map->_values[_index];
+        }
+
+        const KeyType& key() const {
+            return _map->_keys[_index];
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _index == other._index;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _index != other._index;
+        }
+
+        //Note that an iterator should always be default constructible
+        Iterator() = default;
+
+    protected:
+        friend class StaticTreeMap;
+
+        const StaticTreeMap* _map; ///< map being iterated
+        std::size_t _index;        ///< Eytzinger index of the current entry, 0 at the end
+
+        Iterator(const StaticTreeMap* map, std::size_t index) : _map(map), _index(index) {}
+    };
+
+    ADD_ITERATOR_TRAITS()
+
+    /** */
+    const Iterator find(const KeyType& key) const {
+        Iterator it = lower_bound(key);
+        return it != end() && it.key() == key ? it : end();
+    }
+
+    /**
+     * Returns an iterator to the first entry with a key that is
+     * not less than the given one. Descends the whole height of the
+     * tree without branching on comparisons: each step goes to 2i,
+     * or 2i+1 if the key at i is less than the one looked for. The
+     * answer is the last node where the descent went left, found by
+     * undoing the right turns (trailing 1 bits) that followed it.
+     */
+    Iterator lower_bound(const KeyType& key) const {
+        std::size_t i = 1;
+        while (i <= _entryCount) {
+            _prefetch(i * KEYS_PER_LINE);
+            i = 2 * i + (_keys[i] < key);
+        }
+        return Iterator(this, i >> (_trailingOnes(i) + 1));
+    }
+
+    /** */
+    Iterator begin() const {
+        return Iterator(this, _first());
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(this, 0);
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        const Iterator it = find(key);
+        if (it == end()) {
+            throw StaticTreeMapNoSuchElement("at");
+        }
+        return it.value();
+    }
+
+    /** */
+    void print(std::ostream &out=std::cout) const {
+        for (std::size_t i = 1; i <= _entryCount; i++) {
+            out << i << ": " << _keys[i] << " -> " << _values[i] << std::endl;
+        }
+    }
+
+    /** */
+    void diagnose(std::ostream &out=std::cout) const {
+        std::size_t height = 0;
+        for (std::size_t i = _entryCount; i; i >>= 1) {
+            height ++;
+        }
+        out << "total of " << _entryCount << " entries; height is " << height
+            << " bytes per entry is " << sizeof(KeyType) + sizeof(ValueType)
+            << std::endl;
+    }
+
+private:
+
+    /** index of the first entry in key order, 0 if empty */
+    std::size_t _first() const {
+        std::size_t i = _entryCount ? 1 : 0;
+        while (i && 2 * i <= _entryCount) {
+            i = 2 * i;
+        }
+        return i;
+    }
+
+    /** index of the entry after that at i in key order, 0 if none */
+    std::size_t _next(std::size_t i) const {
+        if (2 * i + 1 <= _entryCount) {
+            i = 2 * i + 1;
+            while (2 * i <= _entryCount) {
+                i = 2 * i;
+            }
+            return i;
+        }
+        return i >> (_trailingOnes(i) + 1);
+    }
+
+    static unsigned _trailingOnes(std::size_t i) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(~(unsigned long long)i);
+#else
+        unsigned ones = 0;
+        for (; i & 1; i >>= 1) {
+            ones ++;
+        }
+        return ones;
+#endif
+    }
+
+    /** hints that _keys[i] will be read soon; indices past the end are clamped */
+    void _prefetch(std::size_t i) const {
+#if defined(__GNUC__)
+        __builtin_prefetch(_keys + (i < _entryCount ? i : _entryCount));
+#else
+        (void)i;
+#endif
+    }
+
+    /** allocates (but does not fill) room for count entries */
+    void _allocate(std::size_t count) {
+        std::size_t bytes = (count + 1) * sizeof(KeyType);
+        std::size_t space = bytes + CACHE_LINE;
+        _keyStorage = new char[space];
+        void *aligned = _keyStorage;
+        std::align(CACHE_LINE, bytes, aligned, space);
+        _keys = static_cast<KeyType*>(aligned);
+        std::size_t constructed = 0;
+        try {
+            for (; constructed <= count; constructed++) {
+                new (_keys + constructed) KeyType();
+            }
+            _values = new ValueType[count + 1];
+        } catch (...) {
+            _destroyKeys(constructed);
+            throw;
+        }
+        _entryCount = count;
+    }
+
+    void _destroyKeys(std::size_t constructed) {
+        for (std::size_t i = 0; i < constructed; i++) {
+            _keys[i].~KeyType();
+        }
+        delete[] _keyStorage;
+        _keyStorage = 0;
+        _keys = 0;
+    }
+
+    void _free() {
+        if (_keyStorage) {
+            _destroyKeys(_entryCount + 1);
+        }
+        delete[] _values;
+        _values = 0;
+        _entryCount = 0;
+    }
+
+    void _swap(StaticTreeMap& other) {
+        std::swap(_keys, other._keys);
+        std::swap(_keyStorage, other._keyStorage);
+        std::swap(_values, other._values);
+        std::swap(_entryCount, other._entryCount);
+    }
+};
+
+#endif // __STATICTREEMAP_H
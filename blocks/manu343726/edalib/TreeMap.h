@@ -17,59 +17,107 @@
 
 #include "Util.h"
 #include "BinTree.h"
-#include "Stack.h"
 
 #include <utility> //std::pair<const key,value> instead of custom pair class
+#include <cassert>
+#include <functional>
 
 DECLARE_EXCEPTION(TreeMapNoSuchElement)
 DECLARE_EXCEPTION(TreeMapInvalidAccess)
 
 /**
- * A map implemented using a sorted binary tree. If the tree is kept
- * balanced, this has a guaranteed O(log N) time for lookups, insertions
- * and removals. However, this implementation does not make the effort
- * of keeping it balanced, so it can be much worse.
+ * A map implemented using a sorted binary tree. Since the tree is kept
+ * balanced (it is an AVL tree: the heights of the children of any node 
+ * differ in at most 1), this has a guaranteed O(log N) time for lookups, 
+ * insertions and removals, whatever the order in which keys are inserted.
+ *
+ * Keys are sorted by Compare, a strict weak ordering such as std::less.
+ * Lookups, insertions and removals compare keys once per node on their
+ * way down, through ThreeWayCompare (see Util.h); which is cheaper than
+ * an == and a < for keys such as strings.
  * 
  * @author mfreire
  */
-template <class KeyType, class ValueType>
+template <class KeyType, class ValueType, class Compare = std::less<KeyType>>
 class TreeMap{
 private:
-    typedef std::pair<const KeyType, ValueType> Entry;
-    typedef typename BinTree<Entry>::Node Node;
+    typedef typename MapEntry<const KeyType, ValueType>::type Entry;
+    typedef BinTree<Entry> Tree;
+    typedef typename Tree::Node Node;
     
-    BinTree<Entry> _t; ///< sorted binary tree for key-value entries
+    Tree _t; ///< sorted, balanced binary tree for key-value entries
     std::size_t _entryCount;  ///< number of key-value entries in tree
+    Compare _less; ///< key ordering
+    
+    /// set operations merge subtrees this small one entry at a time, instead of splitting
+    static const std::size_t JOIN_BASE = 16;
     
 public:
 
     /**  */
-    TreeMap() : _t(), _entryCount(0) {}
+    TreeMap() : _t(), _entryCount(0), _less() {}
+
+    /**  */
+    explicit TreeMap(const Compare& less) : _t(), _entryCount(0), _less(less) {}
+
+    /**
+     * Builds a TreeMap from a range of key-value pairs sorted by 
+     * strictly increasing key (as those of another TreeMap or std::map).
+     * The resulting tree is perfectly balanced, and building it takes 
+     * O(N) instead of the O(N log N) of inserting entries one by one.
+     * The range is read twice (once to count it), so It must be at least
+     * a forward iterator. Debug builds check that keys are increasing.
+     */
+    template <class It>
+    static TreeMap from_sorted(It first, It last, const Compare& less = Compare()) {
+        TreeMap map(less);
+        map._entryCount = std::distance(first, last);
+        map._t._root = map._t.buildBalanced(first, map._entryCount);
+        assert(map._strictlyIncreasing());
+        return map;
+    }
 
     /**  */
     std::size_t size() const {
         return _entryCount;
     }
 
+    /** the ordering of keys, which is also the order of iteration */
+    const Compare& key_comp() const {
+        return _less;
+    }
+
+    /** number of nodes in the longest path from the root; 0 if empty */
+    std::size_t height() const {
+        return Tree::height(_t._root);
+    }
+
     class Iterator{
     public:
         void next() {
             if ( ! _current) {
                 throw TreeMapInvalidAccess("next");
-            } else if (_current->_right) {
-                _current = _firstInOrder(_current->_right);
-            } else if (_ascendants.size()) {
-                _current = _ascendants.top();
-                _ascendants.pop();
-            } else {
-                _current = 0;
             }
+            _current = Tree::nextInOrder(_current);
+        }
+        
+        void prev() {
+            Node *prev = _current ? 
+                Tree::prevInOrder(_current) : Tree::lastInOrder(_tree->_root);
+            if ( ! prev) {
+                throw TreeMapInvalidAccess("prev");
+            }
+            _current = prev;
         }
         
         const Entry& elem() const {
             return _current->_elem;
         }
         
+        Entry& elem() {
+            return _current->_elem;
+        }
+        
         const ValueType& value() const {
             return _current->_elem.second;
         }
@@ -92,61 +140,109 @@ public:
     protected:
         friend class TreeMap;
         
-        /** */
+        /** current node, 0 at the end */
         Node* _current;
         
-        /** */
-        Stack<Node*> _ascendants;
+        /** tree being iterated; needed to go back from the end */
+        const Tree* _tree;
 
         /** */        
-        Iterator(Node* start) {
-            _current = _firstInOrder(start);
-        }        
-              
-        /** */
-        Iterator(Node* start, const KeyType& key) {
-            Node *n = start;
-            bool found = false;
-            while (n && ! found) {
-                const KeyType& nodeKey = n->_elem.first;
-                if (nodeKey == key) {
-                    found = true;
-                } else {
-                    if (nodeKey < key) {
-                        _ascendants.push(n);
-                        n = n->_left;                                                
-                    } else {
-                        n = n->_right;                        
-                    }
-                }
-            }
-            _current = _firstInOrder(n);
-        }        
-        
-        Node *_firstInOrder(Node *n) {
-            if (n) {
-                while (n->_left) {
-                    _ascendants.push(n);
-                    n = n->_left;
-                }
-            }
-            return n;
-        }
+        Iterator(const Tree* tree, Node* current) 
+            : _current(current), _tree(tree) {}
     };
     
+    ADD_ITERATOR_TRAITS()
+    
     /** */
     const Iterator find(const KeyType& key) const {
-        return Iterator(_t._root, key);
+        Node *p = _t._root;
+        bool leftChild;
+        return Iterator(&_t, _nodeFor(key, p, leftChild));
     }
     
     /** */
     Iterator begin() const {
-        return Iterator(_t._root);
+        return Iterator(&_t, Tree::firstInOrder(_t._root));
     }
     
     /** */
     Iterator end() const {
-        return Iterator(0);
+        return Iterator(&_t, 0);
+    }
+    
+    /**
+     * A half-open interval [begin, end) of entries of a TreeMap.
+     * Iterate it as any other container.
+     */
+    class Range{
+    public:
+        Iterator begin() const {
+            return _begin;
+        }
+        
+        Iterator end() const {
+            return _end;
+        }
+        
+    protected:
+        friend class TreeMap;
+        
+        Iterator _begin, _end;
+        
+        Range(const Iterator& begin, const Iterator& end) 
+            : _begin(begin), _end(end) {}
+    };
+    
+    /** 
+     * Returns an iterator to the first entry with a key that is not
+     * less than the given one; end() if none. O(log N)
+     */
+    Iterator lower_bound(const KeyType& key) const {
+        Node *n = _t._root, *bound = 0;
+        while (n) {
+            if (_less(n->_elem.first, key)) {
+                n = n->_right;
+            } else {
+                bound = n;
+                n = n->_left;
+            }
+        }
+        return Iterator(&_t, bound);
+    }
+    
+    /** 
+     * Returns an iterator to the first entry with a key that is 
+     * greater than the given one; end() if none. O(log N)
+     */
+    Iterator upper_bound(const KeyType& key) const {
+        Node *n = _t._root, *bound = 0;
+        while (n) {
+            if (_less(key, n->_elem.first)) {
+                bound = n;
+                n = n->_left;
+            } else {
+                n = n->_right;
+            }
+        }
+        return Iterator(&_t, bound);
+    }
+    
+    /** 
+     * Returns the range of entries with the given key: empty if
+     * there are none, a single entry otherwise.
+     */
+    Range equal_range(const KeyType& key) const {
+        return Range(lower_bound(key), upper_bound(key));
+    }
+    
+    /** 
+     * Returns the range of entries with keys in [lo, hi). Only the
+     * O(log N + K) nodes in (or leading to) the range are visited, 
+     * with K the number of entries in the range.
+     */
+    Range range(const KeyType& lo, const KeyType& hi) const {
+        Iterator first = lower_bound(lo);
+        return _less(hi, lo) ? Range(first, first) : Range(first, lower_bound(hi));
     }
     
     /** */
@@ -167,42 +263,122 @@ public:
     
     /** */
     void insert(const KeyType& key, const ValueType& value) {
-        if ( ! _t._root) {
-            _t._root = _t.createNode(std::make_pair(key, value));
-            _entryCount ++;            
-        } else {
-            Node *p = _t._root;
-            bool leftChild;
-            Node *n = _nodeFor(key, p, leftChild);
-            if ( ! n) {
-                if (leftChild) {
-                    p->_left = _t.createNode(std::make_pair(key, value));
-                } else {
-                    p->_right = _t.createNode(std::make_pair(key, value));
-                }                    
-                _entryCount ++;
+        _t._root = _insert(_t._root, key, value, _entryCount);
+        _t._root->_parent = 0;
+    }
+    
+    /** */
+    void erase(const KeyType& key) {
+        _t._root = _erase(_t._root, key);
+        if (_t._root) {
+            _t._root->_parent = 0;
+        }
+        _entryCount --;
+    }
+    
+    /** 
+     * Returns the number of entries with keys less than the given one;
+     * that is, the position the key has (or would have) in key order. 
+     * O(log N)
+     */
+    std::size_t rank(const KeyType& key) const {
+        std::size_t rank = 0;
+        Node *n = _t._root;
+        while (n) {
+            if (_less(n->_elem.first, key)) {
+                rank += Tree::count(n->_left) + 1;
+                n = n->_right;
             } else {
-                n->_elem.second = value;
+                n = n->_left;
             }
         }
+        return rank;
     }
     
-    /** */
-    void erase(const KeyType& key) {
-        Node *p = _t._root;
-        bool leftChild; 
-        Node *n = _nodeFor(key, p, leftChild);
-        if ( ! n) {
-            throw TreeMapNoSuchElement("erase");
-        } else {
-            if (n == _t._root) {
-                _t._root = _erase(n);
-            } else if (leftChild) {
-                p->_left = _erase(n);
+    /** 
+     * Returns an iterator to the entry at position i in key order,
+     * starting from 0; end() if i >= size(). O(log N)
+     */
+    Iterator select(std::size_t i) const {
+        Node *n = _t._root;
+        while (n) {
+            std::size_t left = Tree::count(n->_left);
+            if (i < left) {
+                n = n->_left;
+            } else if (i == left) {
+                break;
             } else {
-                p->_right = _erase(n);
+                i -= left + 1;
+                n = n->_right;
             }
-            _entryCount --;
+        }
+        return Iterator(&_t, n);
+    }
+    
+    /** 
+     * Returns the number of entries with keys in [lo, hi). O(log N)
+     */
+    std::size_t count(const KeyType& lo, const KeyType& hi) const {
+        return _less(hi, lo) ? 0 : rank(hi) - rank(lo);
+    }
+    
+    /**
+     * Erases all entries with keys in [lo, hi). O(K log N), with K the
+     * number of erased entries.
+     * @return the number of erased entries
+     */
+    std::size_t erase_range(const KeyType& lo, const KeyType& hi) {
+        std::size_t erased = 0;
+        Iterator it = lower_bound(lo);
+        while (it != end() && _less(it.key(), hi)) {
+            // only the erased node is freed, so 'it' remains valid
+            KeyType key = it.key();
+            it.next();
+            erase(key);
+            erased ++;
+        }
+        return erased;
+    }
+    
+    /**
+     * Adds every entry of other, overwriting the values of keys that
+     * were already here (as inserting them one by one would). Splits 
+     * this tree around the root of other, unites each half with the 
+     * matching subtree of other, and joins the results; so it takes 
+     * O(M log(N/M + 1)) time when other has M <= N entries, instead of 
+     * O(M log N). Halves with more than grain entries are united in
+     * parallel, with up to the given number of threads. Small subtrees
+     * of other are inserted one entry at a time, which is faster there.
+     */
+    void union_with(const TreeMap& other, unsigned threads = Tree::hardwareThreads(),
+                    std::size_t grain = Tree::PARALLEL_GRAIN) {
+        if (&other != this) {
+            _setRoot(_union(_t._root, other._t._root, threads, grain));
+        }
+    }
+    
+    /**
+     * Keeps only the entries with keys that are also in other. 
+     * Same approach and cost as union_with
+     */
+    void intersect_with(const TreeMap& other, unsigned threads = Tree::hardwareThreads(),
+                        std::size_t grain = Tree::PARALLEL_GRAIN) {
+        if (&other != this) {
+            _setRoot(_intersect(_t._root, other._t._root, threads, grain));
+        }
+    }
+    
+    /**
+     * Erases the entries with keys that are in other. 
+     * Same approach and cost as union_with
+     */
+    void difference_with(const TreeMap& other, unsigned threads = Tree::hardwareThreads(),
+                         std::size_t grain = Tree::PARALLEL_GRAIN) {
+        if (&other == this) {
+            _t.deleteNode(_t._root);
+            _setRoot(0);
+        } else {
+            _setRoot(_difference(_t._root, other._t._root, threads, grain));
         }
     }
     
@@ -213,9 +389,8 @@ public:
     
     /** */
     void diagnose(std::ostream &out=std::cout) {
-        std::size_t depth = 0, max = 0;
-        std::size_t totalDepth = 0;
-        _diagnose(_t._root, depth, max, totalDepth);
+        std::size_t max = Tree::height(_t._root);
+        std::size_t totalDepth = _totalDepth();
         float avg = ( 1.0 / _entryCount) *  totalDepth;     
         std::size_t roundedAvg = (int)avg;
         std::size_t maxForDepth = 0;
@@ -230,58 +405,103 @@ public:
     
 private:
 
+    /** whether in-order keys are strictly increasing, as a search tree needs */
+    bool _strictlyIncreasing() const {
+        Node *prev = 0;
+        for (Node *n = Tree::firstInOrder(_t._root); n; prev = n, n = Tree::nextInOrder(n)) {
+            if (prev && ! _less(prev->_elem.first, n->_elem.first)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     /**
-     * Calculates average path-length stats for the tree
+     * Calculates the sum of the path lengths of all nodes in the tree.
+     * Each node lies on the paths of all nodes in its subtree, so that
+     * is also the sum of all subtree sizes; no recursion needed.
      */
-    static void _diagnose(Node *n, std::size_t depth, std::size_t &max, std::size_t &total) {
-        if (n) {
-            depth ++;
-            total += depth;
-            max = (depth > max) ? depth : max;
-            _diagnose(n->_left, depth, max, total);
-            _diagnose(n->_right, depth, max, total);
+    std::size_t _totalDepth() const {
+        std::size_t total = 0;
+        for (Node *n = Tree::firstInOrder(_t._root); n; n = Tree::nextInOrder(n)) {
+            total += n->_count;
         }
+        return total;
     }
     
     /**
-     * Erases a node, promoting and reordering children as needed
-     * so as to return a tree that is ordered, with only the
-     * deleted node missing.
-     * @param n node to erase
-     * @return a descendant of n, with its own children reordered so that
-     * it forms a valid sorted binary tree.
+     * Inserts a key-value entry into a subtree, or overwrites the value
+     * if the key was already there; rebalancing on the way back up.
+     * @param n root of the subtree to insert into, 0 if empty
+     * @param added incremented if the key was not there
+     * @return the new root of the subtree
      */
-    static Node *_erase(Node *n) {
-        Node *replacement;
-        if ( ! n->_left) {
-            // easy, promote the right child
-            replacement = n->_right;
-        } else if ( ! n->_right) {
-            // easy, promote the left child
-            replacement = n->_left;
+    Node *_insert(Node *n, const KeyType& key, const ValueType& value, std::size_t& added) {
+        if ( ! n) {
+            added ++;
+            return _t.createNode(Entry(key, value));
+        }
+        int order = _compare(key, n->_elem.first);
+        if (order == 0) {
+            n->_elem.second = value;
+            return n;
+        } else if (order < 0) {
+            Tree::setLeft(n, _insert(n->_left, key, value, added));
         } else {
-            // interesting; promote the smallest-of-right
-            // (largest-of-left would also have worked)
-            Node *parentOfSmallest = 0;
-            Node *smallest = n->_right;
-            while (smallest->_left) {
-                parentOfSmallest = smallest;
-                smallest = smallest->_left;
-            }
-            
-            if (parentOfSmallest) {
-                // smallest has a parent; disconnect smallest
-                parentOfSmallest->_left = smallest->_right;
-                smallest->_left = n->_left;
-                smallest->_right = n->_right;
+            Tree::setRight(n, _insert(n->_right, key, value, added));
+        }
+        return Tree::rebalance(n);
+    }
+    
+    /**
+     * Erases the node with a given key from a subtree, promoting and 
+     * reordering children as needed so as to return a tree that is 
+     * ordered and balanced, with only the deleted node missing.
+     * @param n root of the subtree to erase from
+     * @return the new root of the subtree
+     */
+    Node *_erase(Node *n, const KeyType& key) {
+        if ( ! n) {
+            throw TreeMapNoSuchElement("erase");
+        }
+        int order = _compare(key, n->_elem.first);
+        if (order == 0) {
+            Node *replacement;
+            if ( ! n->_left) {
+                // easy, promote the right child
+                replacement = n->_right;
+            } else if ( ! n->_right) {
+                // easy, promote the left child
+                replacement = n->_left;
             } else {
-                // smallest is n->_right; no need to disconnect
-                smallest->_left = n->_left;
+                // interesting; promote the smallest-of-right
+                // (largest-of-left would also have worked)
+                Node *right = _detachSmallest(n->_right, replacement);
+                Tree::setLeft(replacement, n->_left);
+                Tree::setRight(replacement, right);
             }
-            replacement = smallest;
+            delete n;
+            return replacement ? Tree::rebalance(replacement) : 0;
+        } else if (order < 0) {
+            Tree::setLeft(n, _erase(n->_left, key));
+        } else {
+            Tree::setRight(n, _erase(n->_right, key));
+        }
+        return Tree::rebalance(n);
+    }
+    
+    /**
+     * Disconnects the smallest node of a (non-empty) subtree.
+     * @param smallest set to the disconnected node
+     * @return the new root of the subtree, rebalanced
+     */
+    static Node *_detachSmallest(Node *n, Node *&smallest) {
+        if ( ! n->_left) {
+            smallest = n;
+            return n->_right;
         }
-        delete n;
-        return replacement;
+        Tree::setLeft(n, _detachSmallest(n->_left, smallest));
+        return Tree::rebalance(n);
     }
 
     /**
@@ -296,15 +516,15 @@ private:
      * the left of parent; false if to the right or undecided
      * @return node with the key, 0 if not found
      */
-    static Node *_nodeFor(const KeyType& key, Node*& parent, bool &left) {
+    Node *_nodeFor(const KeyType& key, Node*& parent, bool &left) const {
         Node *n = parent;
         while (n) {
-            const KeyType& nodeKey = n->_elem.first;
-            if (nodeKey == key) {
+            int order = _compare(key, n->_elem.first);
+            if (order == 0) {
                 return n;
             } else {
                 parent = n;
-                if (nodeKey < key) {
+                if (order < 0) {
                     left = true;
                     n = n->_left;
                 } else {
@@ -315,6 +535,147 @@ private:
         }
         return n;
     }    
+
+    /** makes n the root, recounting entries */
+    void _setRoot(Node *n) {
+        _t._root = n;
+        if (n) {
+            n->_parent = 0;
+        }
+        _entryCount = Tree::count(n);
+    }
+    
+    /**
+     * Splits a subtree around a key, joining the pieces left on each
+     * side on the way back up. O(log N)
+     * @param left set to the root of a tree with the smaller keys
+     * @param right set to the root of a tree with the larger keys
+     * @return the node with the key, disconnected; 0 if not found
+     */
+    Node *_split(Node *n, const KeyType& key, Node *&left, Node *&right) const {
+        if ( ! n) {
+            left = right = 0;
+            return 0;
+        }
+        Node *l = n->_left, *r = n->_right;
+        int order = _compare(key, n->_elem.first);
+        if (order == 0) {
+            left = l;
+            right = r;
+            n->_left = n->_right = 0;
+            return n;
+        } else if (order < 0) {
+            Node *found = _split(l, key, left, right);
+            right = Tree::join(right, n, r);
+            return found;
+        } else {
+            Node *found = _split(r, key, left, right);
+            left = Tree::join(l, n, left);
+            return found;
+        }
+    }
+    
+    /**
+     * Runs f and g, passing each the number of threads it may use. f
+     * runs in a new thread if there are threads to spare and it is worth it
+     */
+    template <class F, class G>
+    static void _fork(bool worth, unsigned threads, F f, G g) {
+        if (threads < 2 || ! worth) {
+            f(1);
+            g(1);
+            return;
+        }
+        std::future<void> forked = std::async(std::launch::async, [&]() {
+            f(threads / 2);
+        });
+        g(threads - threads / 2);
+        forked.get();
+    }
+    
+    /** 
+     * Unites a subtree of this map (which is consumed) with a subtree 
+     * of another (which is copied from, but not changed)
+     */
+    Node *_union(Node *n, Node *other, unsigned threads, std::size_t grain) {
+        if ( ! other) {
+            return n;
+        } else if ( ! n) {
+            return _t.copyNode(other);
+        } else if (other->_count <= JOIN_BASE) {
+            std::size_t added = 0;
+            auto entries = _t.inorder(other);
+            for (auto it = entries.begin(); it != entries.end(); it.next()) {
+                n = _insert(n, it.elem().first, it.elem().second, added);
+            }
+            return n;
+        }
+        bool worth = n->_count + other->_count > grain;
+        Node *left, *right;
+        delete _split(n, other->_elem.first, left, right);
+        _fork(worth, threads, [&](unsigned t) {
+            left = _union(left, other->_left, t, grain);
+        }, [&](unsigned t) {
+            right = _union(right, other->_right, t, grain);
+        });
+        return Tree::join(left, _t.createNode(other->_elem), right);
+    }
+    
+    /** as _union, keeping the nodes of n with keys in other */
+    Node *_intersect(Node *n, Node *other, unsigned threads, std::size_t grain) {
+        if ( ! n || ! other) {
+            _t.deleteNode(n);
+            return 0;
+        }
+        bool worth = n->_count + other->_count > grain;
+        Node *left, *right;
+        Node *found = _split(n, other->_elem.first, left, right);
+        _fork(worth, threads, [&](unsigned t) {
+            left = _intersect(left, other->_left, t, grain);
+        }, [&](unsigned t) {
+            right = _intersect(right, other->_right, t, grain);
+        });
+        return found ? Tree::join(left, found, right) : Tree::join(left, right);
+    }
+    
+    /** as _union, keeping the nodes of n with keys not in other */
+    Node *_difference(Node *n, Node *other, unsigned threads, std::size_t grain) {
+        if ( ! n || ! other) {
+            return n;
+        } else if (other->_count <= JOIN_BASE) {
+            auto entries = _t.inorder(other);
+            for (auto it = entries.begin(); it != entries.end() && n; it.next()) {
+                Node *parent = n;
+                bool left;
+                if (_nodeFor(it.elem().first, parent, left)) {
+                    n = _erase(n, it.elem().first);
+                }
+            }
+            return n;
+        }
+        bool worth = n->_count + other->_count > grain;
+        Node *left, *right;
+        delete _split(n, other->_elem.first, left, right);
+        _fork(worth, threads, [&](unsigned t) {
+            left = _difference(left, other->_left, t, grain);
+        }, [&](unsigned t) {
+            right = _difference(right, other->_right, t, grain);
+        });
+        return Tree::join(left, right);
+    }
+    
+    /** negative, 0 or positive as a goes before, with or after b */
+    int _compare(const KeyType& a, const KeyType& b) const {
+        return ThreeWayCompare<KeyType, Compare>::compare(_less, a, b);
+    }
 };
 
+/**
+ * A TreeMap sorted by std::less. Can be used wherever a
+ * template<typename,typename> associative container is expected (as
+ * in BaseMap and BaseSet).
+ */
+template <class KeyType, class ValueType>
+using DefaultTreeMap = TreeMap<KeyType, ValueType>;
+
 #endif // __TREEMAP_H
@@ -22,6 +22,9 @@
 #include <stdexcept>
 #include <iterator>
 #include <algorithm>
+#include <functional>
+#include <cstring>
+#include <utility>
 
 //Some cool preprocessor metaprogramming.... 
 
@@ -98,6 +101,78 @@ void print(std::string message, const Container &c, std::ostream &out = std::cou
     out << std::endl;
 }
 
+/**
+ * Three-way comparison through a strict weak ordering: negative if a
+ * goes before b, 0 if they are equivalent, positive if a goes after b.
+ * Takes two calls to less in general; specialize it for keys that can
+ * be compared both ways at once.
+ */
+template<class Key, class Compare>
+struct ThreeWayCompare {
+    static int compare(const Compare& less, const Key& a, const Key& b) {
+        return less(a, b) ? -1 : less(b, a) ? 1 : 0;
+    }
+};
+
+/**
+ * Strings in their usual order take a single memcmp of their common
+ * prefix; the shorter string goes first if that is all the same
+ */
+template<>
+struct ThreeWayCompare<std::string, std::less<std::string>> {
+    static int compare(const std::less<std::string>&, const std::string& a, const std::string& b) {
+        std::size_t common = a.size() < b.size() ? a.size() : b.size();
+        int order = std::memcmp(a.data(), b.data(), common);
+        if (order != 0) {
+            return order;
+        }
+        return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+    }
+};
+
+/**
+ * The value of set entries: sets are maps from their elements to nothing
+ */
+struct EmptyClass {};
+/// std::ostream output
+inline std::ostream& operator<<(std::ostream& out, const EmptyClass&) {
+    return out;
+}
+
+/**
+ * A map entry that only keeps its key, for maps to EmptyClass. Looks
+ * like a std::pair (the value is a shared, static EmptyClass), but
+ * takes no space for the value, nor for the padding after it
+ */
+template<class KeyType>
+struct KeyOnlyEntry {
+    KeyType first;
+    static EmptyClass second;
+
+    KeyOnlyEntry(const KeyType& key, const EmptyClass&) : first(key) {}
+
+    /// as std::pair, converts from pairs of compatible types
+    template<class OtherKey, class OtherValue>
+    KeyOnlyEntry(const std::pair<OtherKey, OtherValue>& entry) : first(entry.first) {}
+};
+
+template<class KeyType>
+EmptyClass KeyOnlyEntry<KeyType>::second;
+
+/**
+ * The entries maps keep for each key and value: a std::pair, except
+ * for maps to EmptyClass (that is, sets)
+ */
+template<class KeyType, class ValueType>
+struct MapEntry {
+    typedef std::pair<KeyType, ValueType> type;
+};
+
+template<class KeyType>
+struct MapEntry<KeyType, EmptyClass> {
+    typedef KeyOnlyEntry<KeyType> type;
+};
+
 namespace util
 {
     /**
@@ -0,0 +1,1605 @@
+/**
+ * @file benchmark.cpp
+ *
+ * Micro-benchmarks for edalib containers. Not exhaustive; they exist to
+ * back up (or debunk) performance-related changes.
+ *
+ * Run without arguments to run every benchmark, or pass the names of the
+ * benchmarks to run. Build in Release mode, or the numbers are meaningless.
+ *
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include <manu343726/edalib/TreeMap.h>
+#include <manu343726/edalib/BPlusTreeMap.h>
+#include <manu343726/edalib/StaticTreeMap.h>
+#include <manu343726/edalib/SplayTreeMap.h>
+#include <manu343726/edalib/ConcurrentSkipListMap.h>
+#include <manu343726/edalib/PersistentTreeMap.h>
+#include <manu343726/edalib/IntervalTree.h>
+#include <manu343726/edalib/Set.h>
+#include <manu343726/edalib/Map.h>
+#include <manu343726/edalib/RoaringBitmap.h>
+#include <manu343726/edalib/Cache.h>
+#include <manu343726/edalib/BloomFilter.h>
+#include <manu343726/edalib/FibHeap.hpp>
+
+/* Utils */
+
+typedef std::chrono::high_resolution_clock bench_clock;
+
+/**
+ * Runs f once, returning the elapsed time in milliseconds
+ */
+template<typename F>
+double elapsed_ms(F f)
+{
+    auto start = bench_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+void report(const std::string& what, double ms, std::size_t operations)
+{
+    std::cout << "  " << std::left << std::setw(44) << what << std::right
+              << std::setw(10) << std::fixed << std::setprecision(2) << ms << " ms"
+              << std::setw(14) << std::setprecision(1) << (1e6 * ms / operations) << " ns/op"
+              << std::endl;
+}
+
+/**
+ * Keys 0..n-1 in sorted, reverse-sorted and shuffled order
+ */
+std::vector<std::pair<std::string, std::vector<int>>> insertion_orders(std::size_t n)
+{
+    std::vector<int> sorted(n);
+    for (std::size_t i = 0; i < n; ++i)
+        sorted[i] = (int)i;
+
+    std::vector<int> reversed(sorted.rbegin(), sorted.rend());
+    std::vector<int> shuffled(sorted);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine{42});
+
+    return { { "sorted", sorted }, { "reverse-sorted", reversed }, { "random", shuffled } };
+}
+
+/* Benchmarks */
+
+/**
+ * TreeMap insertion and lookup with sorted, reverse-sorted and random keys;
+ * an unbalanced tree degenerates into a list with the first two.
+ * std::map is included as a reference.
+ */
+void bench_treemap_insert_order()
+{
+    const std::size_t n = 1 << 20;
+    long long sink = 0;
+
+    for (const auto& order : insertion_orders(n))
+    {
+        const std::vector<int>& keys = order.second;
+        std::cout << order.first << " insertion of " << n << " keys:" << std::endl;
+
+        TreeMap<int, int> t;
+        report("TreeMap::insert", elapsed_ms([&]()
+        {
+            for (int k : keys)
+                t.insert(k, k);
+        }), n);
+        report("TreeMap::at", elapsed_ms([&]()
+        {
+            for (int k : keys)
+                sink += t.at(k);
+        }), n);
+        std::cout << "  ";
+        t.diagnose();
+
+        std::map<int, int> m;
+        report("std::map::insert", elapsed_ms([&]()
+        {
+            for (int k : keys)
+                m.insert(std::make_pair(k, k));
+        }), n);
+        report("std::map::at", elapsed_ms([&]()
+        {
+            for (int k : keys)
+                sink += m.at(k);
+        }), n);
+    }
+
+    std::cout << "(checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * Inserts, looks up and range-scans (from a key found with findStart)
+ * a map with the given keys
+ */
+template<typename M, typename FindStart>
+void bench_ordered_map(const std::string& name, const std::vector<int>& keys, FindStart findStart)
+{
+    const std::size_t scans = 100000, scanLength = 100;
+    long long sink = 0;
+    M map;
+
+    report(name + "::insert", elapsed_ms([&]()
+    {
+        for (int k : keys)
+            map.insert(k, k);
+    }), keys.size());
+    report(name + "::at", elapsed_ms([&]()
+    {
+        for (int k : keys)
+            sink += map.at(k);
+    }), keys.size());
+    report(name + " range scan (100 entries)", elapsed_ms([&]()
+    {
+        for (std::size_t i = 0; i < scans; ++i)
+        {
+            auto it = findStart(map, keys[i]);
+            for (std::size_t j = 0; j < scanLength && it != map.end(); ++j, it.next())
+                sink += it.value();
+        }
+    }), scans);
+    std::cout << "  ";
+    map.diagnose();
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * TreeMap against BPlusTreeMap with different node sizes on random keys
+ */
+void bench_bplustree()
+{
+    const std::size_t n = 1 << 22;
+    const std::vector<int> keys = insertion_orders(n).back().second;
+
+    std::cout << "random insertion of " << n << " keys:" << std::endl;
+    std::cout << "  TreeMap nodes take " << sizeof(BinTree<std::pair<const int, int>>::Node)
+              << " bytes per entry (plus allocator overhead)" << std::endl;
+
+    auto find = [](const TreeMap<int, int>& m, int k) { return m.find(k); };
+    bench_ordered_map<TreeMap<int, int>>("TreeMap", keys, find);
+
+    auto lowerBound = [](const BPlusTreeMap<int, int, 256>& m, int k) { return m.lower_bound(k); };
+    bench_ordered_map<BPlusTreeMap<int, int, 256>>("BPlusTreeMap<256>", keys, lowerBound);
+
+    auto lowerBoundPage = [](const BPlusTreeMap<int, int, 4096>& m, int k) { return m.lower_bound(k); };
+    bench_ordered_map<BPlusTreeMap<int, int, 4096>>("BPlusTreeMap<4096>", keys, lowerBoundPage);
+}
+
+/**
+ * Narrow range queries on a large TreeMap: TreeMap::range against
+ * filtering a scan from begin() (what callers did before), with
+ * std::map as a reference
+ */
+void bench_treemap_range()
+{
+    const std::size_t n = 1 << 22, queries = 100000, width = 16;
+    const std::vector<int> keys = insertion_orders(n).back().second;
+    long long sink = 0;
+
+    TreeMap<int, int> t;
+    std::map<int, int> m;
+    for (int k : keys)
+    {
+        t.insert(k, k);
+        m.insert(std::make_pair(k, k));
+    }
+    std::cout << queries << " range queries of width " << width << " on " << n << " keys:" << std::endl;
+
+    report("TreeMap::range", elapsed_ms([&]()
+    {
+        for (std::size_t i = 0; i < queries; ++i)
+        {
+            auto r = t.range(keys[i], keys[i] + (int)width);
+            for (auto it = r.begin(); it != r.end(); it.next())
+                sink += it.value();
+        }
+    }), queries);
+    report("std::map::lower_bound", elapsed_ms([&]()
+    {
+        for (std::size_t i = 0; i < queries; ++i)
+        {
+            auto last = m.lower_bound(keys[i] + (int)width);
+            for (auto it = m.lower_bound(keys[i]); it != last; ++it)
+                sink += it->second;
+        }
+    }), queries);
+
+    const std::size_t scans = 10;
+    report("filtered scan from TreeMap::begin", elapsed_ms([&]()
+    {
+        for (std::size_t i = 0; i < scans; ++i)
+        {
+            for (auto it = t.begin(); it != t.end(); it.next())
+            {
+                if (keys[i] <= it.key() && it.key() < keys[i] + (int)width)
+                    sink += it.value();
+            }
+        }
+    }), scans);
+
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * Loading sorted entries into a TreeMap: TreeMap::from_sorted against
+ * repeated insertion
+ */
+void bench_treemap_from_sorted()
+{
+    const std::size_t n = 1 << 22;
+    std::vector<std::pair<int, int>> entries;
+    for (std::size_t i = 0; i < n; ++i)
+        entries.push_back(std::make_pair((int)i, (int)i));
+    std::cout << "loading " << n << " sorted entries:" << std::endl;
+
+    {
+        TreeMap<int, int> t;
+        report("TreeMap::insert", elapsed_ms([&]()
+        {
+            for (const auto& e : entries)
+                t.insert(e.first, e.second);
+        }), n);
+        std::cout << "  ";
+        t.diagnose();
+    }
+    {
+        TreeMap<int, int> t;
+        report("TreeMap::from_sorted", elapsed_ms([&]()
+        {
+            t = TreeMap<int, int>::from_sorted(entries.begin(), entries.end());
+        }), n);
+        std::cout << "  ";
+        t.diagnose();
+    }
+}
+
+/**
+ * Join-based TreeMap union, intersection and difference against doing
+ * the same one key at a time, merging maps of several sizes into a big one
+ */
+void bench_treemap_set_algebra()
+{
+    const std::size_t n = 1 << 20;
+    const unsigned threads = BinTree<int>::hardwareThreads();
+    std::default_random_engine random(42);
+    std::uniform_int_distribution<int> keys(0, 1 << 22);
+    TreeMap<int, int> big;
+    while (big.size() < n)
+        big.insert(keys(random), 0);
+
+    for (std::size_t m : { 1 << 10, 1 << 16, 1 << 20 })
+    {
+        TreeMap<int, int> small;
+        while (small.size() < m)
+            small.insert(keys(random), 1);
+        std::vector<int> smallKeys;
+        for (auto it = small.begin(); it != small.end(); it.next())
+            smallKeys.push_back(it.key());
+        std::cout << "merging " << m << " entries into " << n << ", " << threads << " hardware threads:" << std::endl;
+
+        {
+            TreeMap<int, int> copy(big);
+            report("union, one insert at a time", elapsed_ms([&]()
+            {
+                for (int k : smallKeys)
+                    copy.insert(k, 1);
+            }), m);
+        }
+        for (unsigned t : { 1u, threads })
+        {
+            TreeMap<int, int> copy(big);
+            report("union_with, " + std::to_string(t) + " threads", elapsed_ms([&]()
+            {
+                copy.union_with(small, t);
+            }), m);
+        }
+        {
+            TreeMap<int, int> copy(big);
+            report("intersection, one find at a time", elapsed_ms([&]()
+            {
+                TreeMap<int, int> kept;
+                for (int k : smallKeys)
+                    if (copy.find(k) != copy.end())
+                        kept.insert(k, copy.at(k));
+                copy = std::move(kept); // the old entries are freed with kept
+            }), m);
+        }
+        for (unsigned t : { 1u, threads })
+        {
+            TreeMap<int, int> copy(big);
+            report("intersect_with, " + std::to_string(t) + " threads", elapsed_ms([&]()
+            {
+                copy.intersect_with(small, t);
+            }), m);
+        }
+        {
+            TreeMap<int, int> copy(big);
+            report("difference, one erase at a time", elapsed_ms([&]()
+            {
+                for (int k : smallKeys)
+                    if (copy.find(k) != copy.end())
+                        copy.erase(k);
+            }), m);
+        }
+        for (unsigned t : { 1u, threads })
+        {
+            TreeMap<int, int> copy(big);
+            report("difference_with, " + std::to_string(t) + " threads", elapsed_ms([&]()
+            {
+                copy.difference_with(small, t);
+            }), m);
+        }
+    }
+}
+
+/**
+ * Set algebra on hash and tree sets against the loops it replaces:
+ * walking one set and looking its elements up in the other
+ */
+template<typename S>
+void bench_set_algebra(const std::string& name, std::size_t n, std::size_t m)
+{
+    const unsigned threads = BinTree<int>::hardwareThreads();
+    std::default_random_engine random(42);
+    std::uniform_int_distribution<int> keys(0, 1 << 22);
+    S a, b;
+    while (a.size() < n)
+        a.insert(keys(random));
+    while (b.size() < m)
+        b.insert(keys(random));
+    std::cout << name << ", " << n << " and " << m << " elements, " << threads << " hardware threads:" << std::endl;
+
+    std::size_t sink = 0;
+    report("intersection, one lookup at a time", elapsed_ms([&]()
+    {
+        S result;
+        for (auto it = a.begin(); it != a.end(); it.next())
+            if (b.contains(it.key()))
+                result.insert(it.key());
+        sink += result.size();
+    }), n + m);
+    for (unsigned t : { 1u, threads })
+        report("set_intersection, " + std::to_string(t) + " threads", elapsed_ms([&]()
+        {
+            sink += set_intersection(a, b, t).size();
+        }), n + m);
+    report("union, one insert at a time", elapsed_ms([&]()
+    {
+        S result(a);
+        for (auto it = b.begin(); it != b.end(); it.next())
+            result.insert(it.key());
+        sink += result.size();
+    }), n + m);
+    report("set_union", elapsed_ms([&]()
+    {
+        sink += set_union(a, b).size();
+    }), n + m);
+    // a true subset, so that neither stops early
+    S common = set_intersection(a, b);
+    report("is_subset, one lookup at a time", elapsed_ms([&]()
+    {
+        bool subset = true;
+        for (auto it = common.begin(); it != common.end() && subset; it.next())
+            subset = a.contains(it.key());
+        sink += subset;
+    }), n + common.size());
+    for (unsigned t : { 1u, threads })
+        report("is_subset, " + std::to_string(t) + " threads", elapsed_ms([&]()
+        {
+            sink += is_subset(common, a, t);
+        }), n + common.size());
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+void bench_set_algebra()
+{
+    for (std::size_t m : { 1 << 14, 1 << 20 })
+    {
+        bench_set_algebra<Set<int>::H>("Set::H", 1 << 20, m);
+        bench_set_algebra<Set<int>::T>("Set::T", 1 << 20, m);
+    }
+}
+
+/**
+ * Bytes per element of set entries and tree nodes, keeping only the key
+ * against keeping a std::pair<Key, EmptyClass>; and insertion time
+ */
+template<typename K, typename Make>
+void bench_set_memory(const std::string& name, Make make)
+{
+    typedef std::pair<const K, EmptyClass> PairEntry;
+    typedef typename MapEntry<const K, EmptyClass>::type KeyOnly;
+    std::cout << "Set<" << name << ">:" << std::endl;
+    std::cout << "  entries take " << sizeof(KeyOnly) << " bytes, instead of " << sizeof(PairEntry)
+              << "; hash set nodes add two pointers" << std::endl;
+    std::cout << "  tree set nodes take " << sizeof(typename BinTree<KeyOnly>::Node) << " bytes, instead of "
+              << sizeof(typename BinTree<PairEntry>::Node) << " (plus allocator overhead)" << std::endl;
+
+    const std::size_t n = 1 << 20;
+    std::vector<K> keys;
+    for (std::size_t i = 0; i < n; ++i)
+        keys.push_back(make(i));
+    std::size_t sink = 0;
+    report("Set::H insert", elapsed_ms([&]()
+    {
+        typename Set<K>::H set;
+        for (const K& key : keys)
+            set.insert(key);
+        sink += set.size();
+    }), n);
+    report("Set::T insert", elapsed_ms([&]()
+    {
+        typename Set<K>::T set;
+        for (const K& key : keys)
+            set.insert(key);
+        sink += set.size();
+    }), n);
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+void bench_set_memory()
+{
+    bench_set_memory<int>("int", [](std::size_t i) { return int(i * 2654435761u); });
+    bench_set_memory<std::size_t>("size_t", [](std::size_t i) { return i * 2654435761u; });
+    bench_set_memory<std::string>("string", [](std::size_t i)
+    {
+        char key[32];
+        std::snprintf(key, sizeof(key), "key-%012zu", i * 2654435761u % (1u << 31));
+        return std::string(key);
+    });
+}
+
+/**
+ * Set::R against Set::H on integer IDs: drawn from a range 4 times (or
+ * 1000 times) larger than their number, or in runs of consecutive IDs
+ */
+void bench_roaring(const std::string& name, const std::vector<int>& ids, const std::vector<int>& otherIds)
+{
+    const std::size_t n = ids.size();
+    std::cout << n << " " << name << " IDs:" << std::endl;
+    std::size_t sink = 0;
+    Set<int>::H hash, otherHash;
+    Set<int>::R roaring, otherRoaring;
+    RoaringBitmap<int> bitmap;
+    report("Set::H insert", elapsed_ms([&]() { for (int id : ids) hash.insert(id); }), n);
+    report("Set::R insert", elapsed_ms([&]() { for (int id : ids) roaring.insert(id); }), n);
+    for (int id : ids)
+        bitmap.insert(id);
+    for (int id : otherIds)
+    {
+        otherHash.insert(id);
+        otherRoaring.insert(id);
+    }
+    std::cout << "  RoaringBitmap: ";
+    bitmap.diagnose();
+    std::cout << "  " << std::fixed << std::setprecision(2) << double(bitmap.bytes()) / n
+              << " bytes per ID; Set::H nodes alone take " << sizeof(void*) * 3 << std::endl;
+    bitmap.optimize();
+    std::cout << "  optimized: ";
+    bitmap.diagnose();
+
+    // half of the lookups are misses
+    std::vector<int> lookups;
+    for (std::size_t i = 0; i < n; ++i)
+        lookups.push_back(i % 2 ? ids[i * 7919 % n] : ids[i * 7919 % n] + 1);
+    report("Set::H contains", elapsed_ms([&]() { for (int id : lookups) sink += hash.contains(id); }), n);
+    report("Set::R contains", elapsed_ms([&]() { for (int id : lookups) sink += roaring.contains(id); }), n);
+    report("Set::H iterate", elapsed_ms([&]()
+    {
+        for (auto it = hash.begin(); it != hash.end(); it.next())
+            sink += it.key();
+    }), n);
+    report("Set::R iterate", elapsed_ms([&]()
+    {
+        for (auto it = roaring.begin(); it != roaring.end(); it.next())
+            sink += it.key();
+    }), n);
+    report("Set::H intersection", elapsed_ms([&]() { sink += set_intersection(hash, otherHash).size(); }), 2 * n);
+    report("Set::R intersection", elapsed_ms([&]() { sink += set_intersection(roaring, otherRoaring).size(); }), 2 * n);
+    report("Set::H union", elapsed_ms([&]() { sink += set_union(hash, otherHash).size(); }), 2 * n);
+    report("Set::R union", elapsed_ms([&]() { sink += set_union(roaring, otherRoaring).size(); }), 2 * n);
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+void bench_roaring()
+{
+    const std::size_t n = 1 << 21;
+    std::default_random_engine random(42);
+    for (std::size_t spread : { 4, 1000 })
+    {
+        std::uniform_int_distribution<int> ids(0, int(std::min<std::size_t>(n * spread, 1u << 31) - 1));
+        std::vector<int> a, b;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            a.push_back(ids(random));
+            b.push_back(ids(random));
+        }
+        bench_roaring(spread == 4 ? "dense random" : "sparse random", a, b);
+    }
+    std::vector<int> a, b;
+    for (std::size_t i = 0; a.size() < n; i += 1000)
+        for (std::size_t j = 0; j < 500; ++j)
+        {
+            a.push_back(int(i + j));
+            b.push_back(int(i + j + 250));
+        }
+    bench_roaring("consecutive", a, b);
+}
+
+/**
+ * An inverted index (term -> documents) kept in a multimap, against the
+ * usual map from each term to a Vector of documents: building it, listing
+ * the documents of terms, and dropping terms
+ */
+template<typename Multi, typename OfVectors>
+void bench_multimap(const std::string& name, const std::vector<std::pair<int, int>>& postings,
+                    const std::vector<int>& common, const std::vector<int>& any)
+{
+    const std::size_t n = postings.size();
+    std::size_t sink = 0;
+    Multi multi;
+    OfVectors ofVectors;
+    report(name + " multimap insert", elapsed_ms([&]()
+    {
+        for (const auto& p : postings)
+            multi.insert(p.first, p.second);
+    }), n);
+    report(name + " map of Vectors insert", elapsed_ms([&]()
+    {
+        for (const auto& p : postings)
+        {
+            if ( ! ofVectors.contains(p.first))
+                ofVectors.insert(p.first, Vector<int>());
+            ofVectors.at(p.first).push_back(p.second);
+        }
+    }), n);
+    for (const std::vector<int>* queries : { &common, &any })
+    {
+        const std::string which = queries == &common ? " (common terms)" : " (any term)";
+        report(name + " multimap list documents" + which, elapsed_ms([&]()
+        {
+            for (int term : *queries)
+            {
+                auto range = multi.equal_range(term);
+                for (auto it = range.begin(); it != range.end(); it.next())
+                    sink += it.value();
+            }
+        }), queries->size());
+        report(name + " map of Vectors list documents" + which, elapsed_ms([&]()
+        {
+            for (int term : *queries)
+            {
+                const Vector<int>& documents = ofVectors.at(term);
+                for (std::size_t i = 0; i < documents.size(); ++i)
+                    sink += documents.at(i);
+            }
+        }), queries->size());
+    }
+    report(name + " multimap count (any term)", elapsed_ms([&]()
+    {
+        for (int term : any)
+            sink += multi.count(term);
+    }), any.size());
+    report(name + " multimap erase terms", elapsed_ms([&]()
+    {
+        for (int term : any)
+            sink += multi.erase(term);
+    }), any.size());
+    report(name + " map of Vectors erase terms", elapsed_ms([&]()
+    {
+        for (int term : any)
+            if (ofVectors.contains(term))
+            {
+                sink += ofVectors.at(term).size();
+                ofVectors.erase(term);
+            }
+    }), any.size());
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+void bench_multimap()
+{
+    // a Zipf-like mix of terms: a few in many documents, most in one or two
+    const std::size_t n = 1 << 20, terms = 1 << 18, queries = 1 << 12;
+    std::default_random_engine random(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<std::pair<int, int>> postings;
+    std::map<int, std::size_t> frequencies;
+    for (std::size_t doc = 0; postings.size() < n; ++doc)
+        for (int i = 0; i < 8; ++i)
+        {
+            postings.push_back(std::make_pair(int(std::pow(double(terms), uniform(random))) - 1, int(doc)));
+            frequencies[postings.back().first] ++;
+        }
+    std::vector<int> distinct, common, any;
+    std::size_t rare = 0;
+    for (const auto& f : frequencies)
+    {
+        distinct.push_back(f.first);
+        rare += f.second <= 2;
+    }
+    // common terms are picked as often as they appear; any term, uniformly
+    for (std::size_t i = 0; i < queries; ++i)
+    {
+        common.push_back(postings[i * 7919 % n].first);
+        any.push_back(distinct[i * 7919 % distinct.size()]);
+    }
+    std::cout << n << " postings of " << distinct.size() << " terms, "
+              << rare << " of them in at most 2 documents:" << std::endl;
+    bench_multimap<Map<int, int>::MH, Map<int, Vector<int>>::H>("hash", postings, common, any);
+    bench_multimap<Map<int, int>::MT, Map<int, Vector<int>>::T>("tree", postings, common, any);
+}
+
+/**
+ * Orders strings with operator<, but is not std::less; so TreeMap
+ * compares keys twice per node, as it used to
+ */
+struct string_less
+{
+    bool operator()(const std::string& a, const std::string& b) const
+    {
+        return a < b;
+    }
+};
+
+/**
+ * TreeMap lookups on string keys that share long prefixes (as paths or
+ * URLs do), comparing once per node (memcmp-based ThreeWayCompare)
+ * against twice (through a comparator with no ThreeWayCompare)
+ */
+void bench_treemap_strings()
+{
+    const std::size_t queries = 1 << 21;
+    for (std::size_t n : { 1 << 12, 1 << 20 })
+    {
+        std::vector<std::pair<std::string, int>> entries;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            char key[64];
+            std::snprintf(key, sizeof(key), "/var/spool/sessions/user/%012zu", i * 2654435761u % (1u << 31));
+            entries.push_back(std::make_pair(std::string(key), (int)i));
+        }
+        std::vector<std::string> lookups;
+        std::default_random_engine random(42);
+        std::uniform_int_distribution<std::size_t> positions(0, n - 1);
+        for (std::size_t q = 0; q < queries; ++q)
+            lookups.push_back(entries[positions(random)].first);
+        std::sort(entries.begin(), entries.end());
+        std::cout << queries << " lookups on " << n << " string keys of " 
+                  << entries[0].first.size() << " characters:" << std::endl;
+
+        long long sink = 0;
+        auto three = TreeMap<std::string, int>::from_sorted(entries.begin(), entries.end());
+        report("TreeMap::at, three-way", elapsed_ms([&]()
+        {
+            for (const auto& k : lookups)
+                sink += three.at(k);
+        }), queries);
+        auto two = TreeMap<std::string, int, string_less>::from_sorted(entries.begin(), entries.end());
+        report("TreeMap::at, two comparisons", elapsed_ms([&]()
+        {
+            for (const auto& k : lookups)
+                sink += two.at(k);
+        }), queries);
+        std::map<std::string, int> m(entries.begin(), entries.end());
+        report("std::map::at", elapsed_ms([&]()
+        {
+            for (const auto& k : lookups)
+                sink += m.at(k);
+        }), queries);
+        std::cout << "  (checksum " << sink << ")" << std::endl;
+    }
+}
+
+/**
+ * The recursive BinTree copy and teardown that BinTree used to have,
+ * as a reference for the depth-limited and iterative ones
+ */
+template<typename T>
+typename BinTree<T>::Node* recursive_copy(BinTree<T>& t, typename BinTree<T>::Node* n)
+{
+    return n ? t.createNode(n->_elem, recursive_copy(t, n->_left), recursive_copy(t, n->_right)) : nullptr;
+}
+
+template<typename T>
+void recursive_delete(typename BinTree<T>::Node* n)
+{
+    if (n)
+    {
+        recursive_delete<T>(n->_left);
+        recursive_delete<T>(n->_right);
+        delete n;
+    }
+}
+
+/**
+ * The recursive, accumulating in-order traversal that BinTree used to have
+ */
+template<typename T>
+void recursive_inorder(std::vector<T>& accumulator, typename BinTree<T>::Node* n)
+{
+    if (n)
+    {
+        recursive_inorder<T>(accumulator, n->_left);
+        accumulator.push_back(n->_elem);
+        recursive_inorder<T>(accumulator, n->_right);
+    }
+}
+
+/**
+ * BinTree copy and teardown on balanced and degenerate trees
+ */
+void bench_bintree_copy_delete()
+{
+    const std::size_t n = 1 << 22;
+    std::vector<int> elems(n);
+    for (std::size_t i = 0; i < n; ++i)
+        elems[i] = (int)i;
+
+    BinTree<int> balanced;
+    auto first = elems.begin();
+    balanced._root = balanced.buildBalanced(first, n);
+    std::cout << "balanced tree of " << n << " nodes:" << std::endl;
+
+    {
+        // warm up the allocator, so the first run does not pay for page faults
+        BinTree<int> copy(balanced);
+    }
+    {
+        BinTree<int> copy;
+        report("recursive copy", elapsed_ms([&]() { copy._root = recursive_copy(copy, balanced._root); }), n);
+        report("recursive delete", elapsed_ms([&]() { recursive_delete<int>(copy._root); copy._root = nullptr; }), n);
+    }
+    {
+        BinTree<int> copy;
+        report("BinTree::copyNode", elapsed_ms([&]() { copy._root = copy.copyNode(balanced._root); }), n);
+        report("BinTree::deleteNode", elapsed_ms([&]() { copy.deleteNode(copy._root); }), n);
+    }
+    {
+        BinTree<int> copy;
+        report("BinTree::copyNodeIteratively", elapsed_ms([&]() { copy._root = copy.copyNodeIteratively(balanced._root); }), n);
+        report("BinTree::deleteNodeIteratively", elapsed_ms([&]() { copy.deleteNodeIteratively(copy._root); }), n);
+    }
+
+    const std::size_t m = 1 << 20;
+    BinTree<int> degenerate;
+    for (std::size_t i = 0; i < m; ++i)
+        degenerate._root = degenerate.createNode((int)i, degenerate._root);
+    std::cout << "degenerate tree of " << m << " nodes (the recursive versions overflow the stack):" << std::endl;
+
+    {
+        BinTree<int> copy;
+        report("BinTree::copyNode", elapsed_ms([&]() { copy._root = copy.copyNode(degenerate._root); }), m);
+        report("BinTree::deleteNode", elapsed_ms([&]() { copy.deleteNode(copy._root); }), m);
+    }
+}
+
+/**
+ * Sums the elements of a range, one node at a time
+ */
+template<typename R>
+long long sum_range(const R& range)
+{
+    long long sum = 0;
+    for (auto it = range.begin(); it != range.end(); it.next())
+        sum += it.elem();
+    return sum;
+}
+
+/**
+ * Lazy BinTree traversals against materializing the traversal into a
+ * collection, as BinTree used to, and summing that
+ */
+void bench_bintree_traversal()
+{
+    const std::size_t n = 1 << 22;
+    std::vector<int> elems(n);
+    for (std::size_t i = 0; i < n; ++i)
+        elems[i] = (int)i;
+
+    BinTree<int> t;
+    auto first = elems.begin();
+    t._root = t.buildBalanced(first, n);
+    long long sink = 0;
+    std::cout << "summing a balanced tree of " << n << " nodes:" << std::endl;
+
+    report("recursive inorder into a std::vector", elapsed_ms([&]()
+    {
+        std::vector<int> v;
+        recursive_inorder<int>(v, t._root);
+        for (int e : v)
+            sink += e;
+    }), n);
+    report("BinTree::inorder range", elapsed_ms([&]() { sink += sum_range(t.inorder(t._root)); }), n);
+    report("BinTree::morrisInorder", elapsed_ms([&]()
+    {
+        BinTree<int>::morrisInorder(t._root, [&](int e) { sink += e; return true; });
+    }), n);
+    report("BinTree::preorder range", elapsed_ms([&]() { sink += sum_range(t.preorder(t._root)); }), n);
+    report("BinTree::postorder range", elapsed_ms([&]() { sink += sum_range(t.postorder(t._root)); }), n);
+    report("Queue<SingleList> levels into a std::vector", elapsed_ms([&]()
+    {
+        std::vector<int> v;
+        Queue<BinTree<int>::Node*> q;
+        q.push(t._root);
+        while (q.size())
+        {
+            BinTree<int>::Node* current = q.top();
+            q.pop();
+            v.push_back(current->_elem);
+            if (current->_left)
+                q.push(current->_left);
+            if (current->_right)
+                q.push(current->_right);
+        }
+        for (int e : v)
+            sink += e;
+    }), n);
+    report("BinTree::levels range", elapsed_ms([&]() { sink += sum_range(t.levels(t._root)); }), n);
+
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * BinTree::parallel_reduce and parallel_for_each with increasing thread
+ * counts; speedups are relative to a single thread, so they can only 
+ * exceed 1 with as many cores
+ */
+void bench_bintree_parallel()
+{
+    const std::size_t n = 10000000;
+    std::vector<int> elems(n);
+    for (std::size_t i = 0; i < n; ++i)
+        elems[i] = (int)i;
+
+    BinTree<int> t;
+    auto first = elems.begin();
+    t._root = t.buildBalanced(first, n);
+    long long sink = 0;
+    unsigned cores = std::thread::hardware_concurrency();
+    std::cout << "balanced tree of " << n << " nodes, " << cores << " hardware threads:" << std::endl;
+
+    auto map = [](int e) { return (long long)e * e % 7; };
+    double single = 0;
+    for (unsigned threads = 1; threads <= std::max(8u, cores); threads *= 2)
+    {
+        double ms = elapsed_ms([&]() { sink += BinTree<int>::parallel_reduce(t._root, map, std::plus<long long>(), threads); });
+        single = threads == 1 ? ms : single;
+        report("parallel_reduce, " + std::to_string(threads) + " threads", ms, n);
+        std::cout << "    speedup " << std::setprecision(2) << single / ms << std::endl;
+    }
+    for (unsigned threads = 1; threads <= std::max(8u, cores); threads *= 2)
+    {
+        double ms = elapsed_ms([&]() { BinTree<int>::parallel_for_each(t._root, [](int& e) { e ^= 1; }, threads); });
+        single = threads == 1 ? ms : single;
+        report("parallel_for_each, " + std::to_string(threads) + " threads", ms, n);
+        std::cout << "    speedup " << std::setprecision(2) << single / ms << std::endl;
+    }
+
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * Random lookups on StaticTreeMap against TreeMap and a binary search
+ * on a sorted array, for maps that fit in L1 to maps far beyond the
+ * last-level cache
+ */
+void bench_static_treemap()
+{
+    const std::size_t queries = 1 << 21;
+
+    for (std::size_t n = 1 << 10; n <= (1 << 24); n <<= 2)
+    {
+        std::vector<std::pair<int, int>> entries;
+        std::vector<int> sorted;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            entries.push_back(std::make_pair(2 * (int)i, (int)i));
+            sorted.push_back(2 * (int)i);
+        }
+        std::vector<int> lookups(queries);
+        std::default_random_engine random(42);
+        std::uniform_int_distribution<int> keys(0, 2 * (int)n);
+        for (int& k : lookups)
+            k = keys(random);
+
+        auto t = TreeMap<int, int>::from_sorted(entries.begin(), entries.end());
+        StaticTreeMap<int, int> frozen(t);
+        long long sink = 0;
+        std::cout << queries << " lookups on " << n << " keys (" << (n * sizeof(int) >> 10) << " KB of keys):" << std::endl;
+
+        report("TreeMap::lower_bound", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+            {
+                auto it = t.lower_bound(k);
+                sink += it != t.end() ? it.value() : 0;
+            }
+        }), queries);
+        report("std::lower_bound on a sorted array", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+            {
+                auto it = std::lower_bound(sorted.begin(), sorted.end(), k);
+                sink += it != sorted.end() ? (it - sorted.begin()) : 0;
+            }
+        }), queries);
+        report("StaticTreeMap::lower_bound", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+            {
+                auto it = frozen.lower_bound(k);
+                sink += it != frozen.end() ? it.value() : 0;
+            }
+        }), queries);
+        std::cout << "  (checksum " << sink << ")" << std::endl;
+    }
+}
+
+/**
+ * count keys drawn from 0..n-1 with a Zipf distribution of exponent s:
+ * the key of rank r is drawn with probability proportional to 1/r^s.
+ * Ranks are assigned to keys at random, so hot keys are not neighbours.
+ */
+std::vector<int> zipf_keys(std::size_t n, double s, std::size_t count)
+{
+    std::vector<double> cdf(n);
+    double total = 0;
+    for (std::size_t r = 0; r < n; ++r)
+        cdf[r] = (total += 1.0 / std::pow((double)(r + 1), s));
+
+    std::vector<int> keyOfRank(n);
+    for (std::size_t r = 0; r < n; ++r)
+        keyOfRank[r] = (int)r;
+    std::default_random_engine random(42);
+    std::shuffle(keyOfRank.begin(), keyOfRank.end(), random);
+
+    std::uniform_real_distribution<double> uniform(0, total);
+    std::vector<int> keys(count);
+    for (int& k : keys)
+        k = keyOfRank[std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin()];
+    return keys;
+}
+
+/**
+ * Lookups with Zipf-distributed keys (exponent 0 is uniform) on a
+ * SplayTreeMap, a TreeMap and a std::map
+ */
+void bench_splay_zipf()
+{
+    const std::size_t n = 1 << 20, queries = 1 << 22;
+    std::vector<std::pair<int, int>> entries;
+    for (std::size_t i = 0; i < n; ++i)
+        entries.push_back(std::make_pair((int)i, (int)i));
+
+    auto t = TreeMap<int, int>::from_sorted(entries.begin(), entries.end());
+    std::map<int, int> m(entries.begin(), entries.end());
+    SplayTreeMap<int, int> splay;
+    const std::vector<int> shuffled = insertion_orders(n).back().second;
+    for (int k : shuffled)
+        splay.insert(k, k);
+
+    for (double exponent : { 0.0, 0.8, 1.0, 1.2 })
+    {
+        const std::vector<int> lookups = zipf_keys(n, exponent, queries);
+        long long sink = 0;
+        std::cout << queries << " lookups on " << n << " keys, Zipf exponent " 
+                  << std::setprecision(1) << exponent << ":" << std::endl;
+
+        report("SplayTreeMap::find", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+                sink += splay.find(k).value();
+        }), queries);
+        report("TreeMap::find", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+                sink += t.find(k).value();
+        }), queries);
+        report("std::map::find", elapsed_ms([&]()
+        {
+            for (int k : lookups)
+                sink += m.find(k)->second;
+        }), queries);
+        std::cout << "  ";
+        splay.diagnose();
+        std::cout << "  (checksum " << sink << ")" << std::endl;
+    }
+}
+
+/**
+ * Runs ops operations on each of the given number of threads: finds
+ * with probability readPercent / 100, else inserts or erases (half and
+ * half) of random keys below keyRange. Returns the elapsed time
+ */
+template<typename Find, typename Insert, typename Erase>
+double concurrent_mix(unsigned threads, std::size_t ops, int readPercent, int keyRange,
+                      Find find, Insert insert, Erase erase)
+{
+    return elapsed_ms([&]()
+    {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]()
+            {
+                std::default_random_engine random(t);
+                std::uniform_int_distribution<int> keys(0, keyRange - 1), percent(0, 99);
+                for (std::size_t i = 0; i < ops; ++i)
+                {
+                    int k = keys(random), p = percent(random);
+                    if (p < readPercent)
+                        find(k);
+                    else if (p % 2)
+                        insert(k);
+                    else
+                        erase(k);
+                }
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+    });
+}
+
+/**
+ * ConcurrentSkipListMap against a TreeMap guarded by a mutex, with
+ * several thread counts and read/write mixes; the number of operations
+ * per thread is fixed, so perfect scaling keeps ns/op constant
+ */
+void bench_concurrent_skiplist()
+{
+    const int keyRange = 1 << 20;
+    const std::size_t ops = 1 << 17;
+    std::cout << "random keys below " << keyRange << ", half of them in the map, "
+              << std::thread::hardware_concurrency() << " hardware threads:" << std::endl;
+
+    for (int readPercent : { 90, 50, 10 })
+    {
+        for (unsigned threads = 1; threads <= 8; threads *= 2)
+        {
+            std::string mix = std::to_string(readPercent) + "% finds, " + std::to_string(threads) + " threads";
+
+            ConcurrentSkipListMap<int, int> skipList;
+            TreeMap<int, int> tree;
+            std::mutex treeMutex;
+            for (int k = 0; k < keyRange; k += 2)
+            {
+                skipList.insert(k, k);
+                tree.insert(k, k);
+            }
+
+            std::atomic<long long> sink(0);
+            report("ConcurrentSkipListMap, " + mix, concurrent_mix(threads, ops, readPercent, keyRange,
+                [&](int k) { sink += skipList.find(k) != skipList.end(); },
+                [&](int k) { skipList.insert(k, k); },
+                [&](int k)
+                {
+                    // another thread may erase it first
+                    try { if (skipList.find(k) != skipList.end()) skipList.erase(k); }
+                    catch (ConcurrentSkipListMapNoSuchElement&) {}
+                }), ops * threads);
+            report("mutex-guarded TreeMap, " + mix, concurrent_mix(threads, ops, readPercent, keyRange,
+                [&](int k) { std::lock_guard<std::mutex> lock(treeMutex); sink += tree.find(k) != tree.end(); },
+                [&](int k) { std::lock_guard<std::mutex> lock(treeMutex); tree.insert(k, k); },
+                [&](int k)
+                {
+                    std::lock_guard<std::mutex> lock(treeMutex);
+                    if (tree.find(k) != tree.end()) tree.erase(k);
+                }), ops * threads);
+        }
+    }
+}
+
+/**
+ * Point-in-time snapshots of a map that keeps changing: copying a whole
+ * TreeMap against an O(1) PersistentTreeMap copy, and the cost of updates
+ * when a snapshot is taken (and kept until the next one) every so often
+ */
+void bench_persistent_treemap()
+{
+    const std::size_t n = 1 << 20, updates = 1 << 20;
+    std::vector<std::pair<int, int>> entries;
+    for (std::size_t i = 0; i < n; ++i)
+        entries.push_back(std::make_pair(2 * (int)i, (int)i));
+    std::vector<int> keys(updates);
+    std::default_random_engine random(42);
+    std::uniform_int_distribution<int> distribution(0, 2 * (int)n - 1);
+    for (int& k : keys)
+        k = distribution(random);
+
+    auto t = TreeMap<int, int>::from_sorted(entries.begin(), entries.end());
+    PersistentTreeMap<int, int> p;
+    for (const auto& e : entries)
+        p.insert(e.first, e.second);
+    std::cout << "maps of " << n << " entries:" << std::endl;
+
+    {
+        TreeMap<int, int> snapshot;
+        const int copies = 16;
+        report("TreeMap copy", elapsed_ms([&]()
+        {
+            for (int i = 0; i < copies; ++i)
+                snapshot = t;
+        }), copies);
+        PersistentTreeMap<int, int> version;
+        report("PersistentTreeMap copy", elapsed_ms([&]()
+        {
+            for (std::size_t i = 0; i < updates; ++i)
+                version = p;
+        }), updates);
+    }
+
+    std::cout << updates << " random insertions and removals, with a snapshot every so often:" << std::endl;
+    for (std::size_t every : { updates, (std::size_t)1 << 16 })
+    {
+        TreeMap<int, int> copy(t), snapshot;
+        report("TreeMap, snapshot every " + std::to_string(every), elapsed_ms([&]()
+        {
+            for (std::size_t i = 0; i < updates; ++i)
+            {
+                if (i % every == 0)
+                    snapshot = copy;
+                if (keys[i] % 2)
+                    copy.insert(keys[i], 0);
+                else if (copy.find(keys[i]) != copy.end())
+                    copy.erase(keys[i]);
+            }
+        }), updates);
+    }
+    for (std::size_t every : { updates, (std::size_t)1 << 16, (std::size_t)1 << 10, (std::size_t)1 })
+    {
+        PersistentTreeMap<int, int> version(p), snapshot;
+        report("PersistentTreeMap, snapshot every " + std::to_string(every), elapsed_ms([&]()
+        {
+            for (std::size_t i = 0; i < updates; ++i)
+            {
+                if (i % every == 0)
+                    snapshot = version;
+                if (keys[i] % 2)
+                    version.insert(keys[i], 0);
+                else if (version.find(keys[i]) != version.end())
+                    version.erase(keys[i]);
+            }
+        }), updates);
+    }
+}
+
+/**
+ * Stabbing and overlap queries on an IntervalTree against scanning
+ * every interval, with short and long intervals
+ */
+void bench_interval_tree()
+{
+    const std::size_t n = 1 << 20, queries = 1 << 10, treeQueries = 1 << 16;
+    const int range = 1 << 30;
+    std::default_random_engine random(42);
+    std::uniform_int_distribution<int> points(0, range - 1);
+
+    for (int maxLength : { 1 << 10, 1 << 20 })
+    {
+        std::uniform_int_distribution<int> lengths(1, maxLength);
+        std::vector<std::pair<int, int>> intervals;
+        IntervalTree<int, int> tree;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            int start = points(random);
+            intervals.push_back(std::make_pair(start, start + lengths(random)));
+            tree.insert(intervals.back().first, intervals.back().second, (int)i);
+        }
+        std::vector<int> lookups(treeQueries);
+        for (int& x : lookups)
+            x = points(random);
+        std::cout << n << " intervals of up to " << maxLength << " points, in [0, " << range << "):" << std::endl;
+
+        for (int queryLength : { 0, 1 << 16 })
+        {
+            std::size_t found = 0;
+            const std::string what = queryLength ? "overlapping 2^16 points" : "containing a point";
+            report("scan, " + what, elapsed_ms([&]()
+            {
+                for (std::size_t q = 0; q < queries; ++q)
+                {
+                    int lo = lookups[q], hi = lo + queryLength;
+                    for (const auto& i : intervals)
+                        if (lo < i.second && (queryLength ? i.first < hi : i.first <= lo))
+                            found ++;
+                }
+            }), queries);
+            auto count = [&](const IntervalTree<int, int>::Entry&) { found ++; };
+            report("IntervalTree, " + what, elapsed_ms([&]()
+            {
+                for (int lo : lookups)
+                {
+                    if (queryLength)
+                        tree.overlapping(lo, lo + queryLength, count);
+                    else
+                        tree.containing(lo, count);
+                }
+            }), treeQueries);
+            std::cout << "  (" << found << " found)" << std::endl;
+        }
+    }
+}
+
+/**
+ * A blocklist of host names in a Set::H, against a Set::HF, which puts a
+ * blocked Bloom filter in front of the table: lookups of names that are
+ * not there (most of them), and of names that are
+ */
+void bench_bloom()
+{
+    const std::size_t n = 1 << 20;
+    std::vector<std::string> blocked, other;
+    for (std::size_t i = 0; i < 2 * n; ++i)
+    {
+        char name[48];
+        std::snprintf(name, sizeof(name), "host-%010zu.example.com", i * 2654435761u % (1u << 31));
+        (i < n ? blocked : other).push_back(name);
+    }
+    for (std::size_t bitsPerKey : { 10, 20 })
+    {
+        BlockedBloomFilter filter(n, bitsPerKey);
+        for (std::size_t i = 0; i < n; ++i)
+            filter.add(::hash(blocked[i]));
+        std::size_t falsePositives = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            falsePositives += filter.mayContain(::hash(other[i]));
+        std::cout << "  false positives with " << bitsPerKey << " bits per key: " << std::setprecision(3)
+                  << (100.0 * falsePositives / n) << "% (the filter of a Set::HF has 10 to 20)" << std::endl;
+    }
+
+    std::size_t sink = 0;
+    Set<std::string>::H plain;
+    Set<std::string>::HF filtered;
+    report("Set::H insert", elapsed_ms([&]() { for (const std::string& name : blocked) plain.insert(name); }), n);
+    report("Set::HF insert", elapsed_ms([&]() { for (const std::string& name : blocked) filtered.insert(name); }), n);
+    report("Set::H contains (misses)", elapsed_ms([&]() { for (const std::string& name : other) sink += plain.contains(name); }), n);
+    report("Set::HF contains (misses)", elapsed_ms([&]() { for (const std::string& name : other) sink += filtered.contains(name); }), n);
+    report("Set::H contains (hits)", elapsed_ms([&]() { for (const std::string& name : blocked) sink += plain.contains(name); }), n);
+    report("Set::HF contains (hits)", elapsed_ms([&]() { for (const std::string& name : blocked) sink += filtered.contains(name); }), n);
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * The LRU cache services used to hand-roll: a Map::H from keys to values
+ * and positions in a DoubleList, kept most recently used first. A hit
+ * looks its key up twice, and moves it by allocating a new list node
+ */
+class HandRolledLRU
+{
+    typedef DoubleList<int> Order;
+    Map<int, std::pair<int, Order::Iterator>>::H _entries;
+    Order _order;
+    std::size_t _capacity;
+
+public:
+    explicit HandRolledLRU(std::size_t capacity) : _capacity(capacity) {}
+
+    int* get(int key)
+    {
+        if ( ! _entries.contains(key))
+            return 0;
+        std::pair<int, Order::Iterator>& entry = _entries.at(key);
+        _order.erase(entry.second);
+        _order.push_front(key);
+        entry.second = _order.begin();
+        return &entry.first;
+    }
+
+    void put(int key, int value)
+    {
+        if (_entries.size() == _capacity)
+        {
+            _entries.erase(_order.back());
+            _order.pop_back();
+        }
+        _order.push_front(key);
+        _entries.insert(key, std::make_pair(value, _order.begin()));
+    }
+};
+
+/**
+ * Read-through caching of a skewed key stream: get, and put on a miss.
+ * Keys follow a Zipf-like distribution, with the cache holding 1/16 of
+ * them, or 1/256
+ */
+template<typename C>
+std::size_t bench_cache(const std::string& name, const std::vector<int>& keys, std::size_t capacity)
+{
+    C cache(capacity);
+    std::size_t hits = 0, sink = 0;
+    double ms = elapsed_ms([&]()
+    {
+        for (int key : keys)
+        {
+            int *value = cache.get(key);
+            if (value)
+            {
+                hits ++;
+                sink += *value;
+            }
+            else
+            {
+                cache.put(key, key);
+            }
+        }
+    });
+    std::ostringstream what;
+    what << name << " (" << std::setprecision(1) << std::fixed << (100.0 * hits / keys.size()) << "% hits)";
+    report(what.str(), ms, keys.size());
+    return sink;
+}
+
+void bench_cache()
+{
+    const std::size_t universe = 1 << 20, n = 1 << 22;
+    std::default_random_engine random(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<int> keys;
+    for (std::size_t i = 0; i < n; ++i)
+        keys.push_back(int(std::pow(double(universe), uniform(random))) - 1);
+    for (std::size_t capacity : { universe / 16, universe / 256 })
+    {
+        std::cout << n << " gets of " << universe << " keys, capacity " << capacity << ":" << std::endl;
+        std::size_t sink = bench_cache<HandRolledLRU>("Map::H + DoubleList LRU", keys, capacity);
+        sink += bench_cache<Cache<int, int, LRUPolicy>>("Cache<LRUPolicy>", keys, capacity);
+        sink += bench_cache<Cache<int, int, LFUPolicy>>("Cache<LFUPolicy>", keys, capacity);
+        sink += bench_cache<Cache<int, int, ClockPolicy>>("Cache<ClockPolicy>", keys, capacity);
+        std::cout << "  (checksum " << sink << ")" << std::endl;
+    }
+}
+
+/**
+ * Shortest paths on a random sparse graph, with the two ways of keeping
+ * the frontier in a FibHeap: lazily, inserting a vertex again whenever
+ * its distance improves and skipping the stale copies when extracted; or
+ * with one element per vertex, whose key is decreased instead
+ */
+struct weighted_edge
+{
+    int to, weight;
+};
+
+typedef std::vector<std::vector<weighted_edge>> weighted_graph;
+
+std::vector<long long> dijkstra_lazy(const weighted_graph& graph, std::size_t& extractions)
+{
+    typedef std::pair<long long, int> entry; //(distance, vertex)
+    std::vector<long long> distance(graph.size(), -1);
+    std::vector<bool> done(graph.size(), false);
+    FibHeap<entry> frontier;
+    distance[0] = 0;
+    frontier.insert(entry(0, 0));
+    while ( ! frontier.empty())
+    {
+        entry e = frontier.extract_min();
+        extractions ++;
+        if (done[e.second])
+            continue;
+        done[e.second] = true;
+        for (const weighted_edge& edge : graph[e.second])
+        {
+            long long d = e.first + edge.weight;
+            if (distance[edge.to] < 0 || d < distance[edge.to])
+            {
+                distance[edge.to] = d;
+                frontier.insert(entry(d, edge.to));
+            }
+        }
+    }
+    return distance;
+}
+
+std::vector<long long> dijkstra_decrease_key(const weighted_graph& graph, std::size_t& extractions)
+{
+    typedef std::pair<long long, int> entry;
+    typedef FibHeap<entry> heap;
+    std::vector<long long> distance(graph.size(), -1);
+    std::vector<heap::handle> handles(graph.size());
+    std::vector<bool> done(graph.size(), false);
+    heap frontier;
+    distance[0] = 0;
+    handles[0] = frontier.insert(entry(0, 0));
+    while ( ! frontier.empty())
+    {
+        entry e = frontier.extract_min();
+        extractions ++;
+        done[e.second] = true;
+        for (const weighted_edge& edge : graph[e.second])
+        {
+            long long d = e.first + edge.weight;
+            if (distance[edge.to] < 0)
+            {
+                distance[edge.to] = d;
+                handles[edge.to] = frontier.insert(entry(d, edge.to));
+            }
+            else if (d < distance[edge.to] && ! done[edge.to])
+            {
+                distance[edge.to] = d;
+                frontier.decrease_key(handles[edge.to], entry(d, edge.to));
+            }
+        }
+    }
+    return distance;
+}
+
+void bench_fibheap_dijkstra(std::size_t n, std::size_t degree)
+{
+    std::default_random_engine random(42);
+    std::uniform_int_distribution<int> vertex(0, n - 1), weight(1, 1000);
+    weighted_graph graph(n);
+    for (std::size_t v = 0; v < n; ++v)
+        for (std::size_t i = 0; i < degree; ++i)
+            graph[v].push_back(weighted_edge{ vertex(random), weight(random) });
+
+    std::vector<long long> lazy, decreased;
+    std::size_t lazyExtractions = 0, decreasedExtractions = 0;
+    std::cout << n << " vertices, " << n * degree << " edges:" << std::endl;
+    report("FibHeap, reinserting", elapsed_ms([&]() { lazy = dijkstra_lazy(graph, lazyExtractions); }), n);
+    report("FibHeap, decrease_key", elapsed_ms([&]() { decreased = dijkstra_decrease_key(graph, decreasedExtractions); }), n);
+    std::cout << "  extract_min calls: " << lazyExtractions << " reinserting, "
+              << decreasedExtractions << " with decrease_key"
+              << (lazy == decreased ? "" : " (DISTANCES DIFFER)") << std::endl;
+}
+
+void bench_fibheap_dijkstra()
+{
+    bench_fibheap_dijkstra(1 << 18, 8);
+    bench_fibheap_dijkstra(1 << 16, 64);
+}
+
+/**
+ * Insertions and extractions on FibHeaps whose nodes come from malloc
+ * (std::allocator) or from the default node_pool: filling and draining
+ * a heap, and the hold model of event simulations, where each step
+ * extracts the next event and schedules a later one
+ */
+template<typename Allocator>
+long long bench_fibheap_alloc(const std::string& name, const std::vector<int>& keys, std::size_t held)
+{
+    long long sink = 0;
+    report(name + ", fill and drain", elapsed_ms([&]()
+    {
+        for (int round = 0; round < 4; ++round)
+        {
+            FibHeap<int, std::less<int>, Allocator> heap;
+            for (int key : keys)
+                heap.insert(key);
+            while ( ! heap.empty())
+                sink += heap.extract_min();
+        }
+    }), 4 * keys.size());
+
+    FibHeap<int, std::less<int>, Allocator> events;
+    for (std::size_t i = 0; i < held; ++i)
+        events.insert(keys[i] % 1000);
+    report(name + ", hold", elapsed_ms([&]()
+    {
+        for (int key : keys)
+        {
+            int now = events.extract_min();
+            events.insert(now + key % 1000 + 1);
+            sink += now;
+        }
+    }), keys.size());
+    return sink;
+}
+
+void bench_fibheap_alloc()
+{
+    const std::size_t n = 1 << 18, held = 1 << 16;
+    std::default_random_engine random(42);
+    std::vector<int> keys;
+    for (std::size_t i = 0; i < n; ++i)
+        keys.push_back(random() % (1 << 30));
+    std::cout << n << " keys, holding " << held << " events:" << std::endl;
+    long long sink = bench_fibheap_alloc<std::allocator<impl::node<int>>>("std::allocator", keys, held);
+    sink += bench_fibheap_alloc<impl::node_pool<impl::node<int>>>("impl::node_pool", keys, held);
+    std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+/**
+ * Latency of each extract_min while draining a FibHeap of random keys.
+ * The first call consolidates n roots; later ones, O(log n) on average
+ */
+void bench_fibheap_extract_min()
+{
+    std::default_random_engine random(42);
+    for (std::size_t n : { 1 << 10, 1 << 14, 1 << 18 })
+    {
+        FibHeap<int> heap;
+        for (std::size_t i = 0; i < n; ++i)
+            heap.insert((int)(random() % (1 << 30)));
+
+        std::vector<double> latencies;
+        latencies.reserve(n);
+        long long sink = 0;
+        double ms = elapsed_ms([&]()
+        {
+            while ( ! heap.empty())
+            {
+                auto start = bench_clock::now();
+                sink += heap.extract_min();
+                latencies.push_back(std::chrono::duration<double, std::nano>(bench_clock::now() - start).count());
+            }
+        });
+        std::ostringstream what;
+        what << "extract_min, " << n << " elements";
+        report(what.str(), ms, n);
+        double first = latencies[0];
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "    first " << std::setprecision(0) << first << " ns, median "
+                  << latencies[n / 2] << " ns, p99 " << latencies[n * 99 / 100] << " ns"
+                  << " (checksum " << sink << ")" << std::endl;
+    }
+}
+
+struct benchmark
+{
+    const char* name;
+    void (*run)();
+};
+
+int main(int argc, char* argv[])
+{
+    const benchmark benchmarks[] = {
+        { "treemap_insert_order", bench_treemap_insert_order },
+        { "bplustree", bench_bplustree },
+        { "treemap_range", bench_treemap_range },
+        { "treemap_from_sorted", bench_treemap_from_sorted },
+        { "treemap_strings", bench_treemap_strings },
+        { "treemap_set_algebra", bench_treemap_set_algebra },
+        { "set_algebra", bench_set_algebra },
+        { "set_memory", bench_set_memory },
+        { "roaring", bench_roaring },
+        { "multimap", bench_multimap },
+        { "bloom", bench_bloom },
+        { "cache", bench_cache },
+        { "fibheap_dijkstra", bench_fibheap_dijkstra },
+        { "fibheap_alloc", bench_fibheap_alloc },
+        { "fibheap_extract_min", bench_fibheap_extract_min },
+        { "bintree_copy_delete", bench_bintree_copy_delete },
+        { "bintree_traversal", bench_bintree_traversal },
+        { "bintree_parallel", bench_bintree_parallel },
+        { "static_treemap", bench_static_treemap },
+        { "splay_zipf", bench_splay_zipf },
+        { "concurrent_skiplist", bench_concurrent_skiplist },
+        { "persistent_treemap", bench_persistent_treemap },
+        { "interval_tree", bench_interval_tree },
+    };
+
+    for (const benchmark& b : benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || std::strcmp(argv[i], b.name) == 0;
+
+        if (selected)
+        {
+            std::cout << "== " << b.name << std::endl;
+            b.run();
+        }
+    }
+}
@@ -20,12 +20,16 @@ struct asociative_container_tag{};
  * - A container adapter is any template with a type parameter and a linear container template parameter,
  * - An asociative container is any template with two type parameters (key,value) and a linear container 
  *   template parameter.
+ * - A map container is an asociative container with two type parameters (key,value) only, like SplayTreeMap.
+ * - A sorted map container is a map container with a third type parameter (the key ordering), like TreeMap.
  */
 
 //Ugly macros to make the code much more readable for non-C++ers
 #define LINEAR_CONTAINER template<typename> class
 #define CONTAINER_ADAPTER template<typename,LINEAR_CONTAINER> class
 #define ASSOCIATIVE_CONTAINER template<typename,typename,LINEAR_CONTAINER> class
+#define MAP_CONTAINER template<typename,typename> class
+#define SORTED_MAP_CONTAINER template<typename,typename,typename> class
 
 
 template<LINEAR_CONTAINER C , typename T>
@@ -55,6 +59,27 @@ struct container_traits<C<KEY, VALUE, UC>>
     typedef UC<value_type>             bucket_container;
 };
 
+template<MAP_CONTAINER C , typename KEY , typename VALUE>
+struct container_traits<C<KEY, VALUE>>
+{
+    typedef asociative_container_tag container_category;
+
+    typedef std::pair<const KEY, VALUE> value_type;
+    typedef KEY                        key_type;
+    typedef VALUE                      mapped_type;
+};
+
+template<SORTED_MAP_CONTAINER C , typename KEY , typename VALUE , typename COMPARE>
+struct container_traits<C<KEY, VALUE, COMPARE>>
+{
+    typedef asociative_container_tag container_category;
+
+    typedef std::pair<const KEY, VALUE> value_type;
+    typedef KEY                        key_type;
+    typedef VALUE                      mapped_type;
+    typedef COMPARE                    key_compare;
+};
+
 
 
 
@@ -2,9 +2,14 @@
 #include <cassert>
 #include <ctime>
 #include <cstdlib>
+#include <cmath>
 #include <numeric>
 #include <queue>
+#include <set>
+#include <map>
+#include <list>
 #include <random>
+#include <thread>
 
 #include <manu343726/edalib/container_adapters.hpp>
 
@@ -17,6 +22,13 @@
 #include <manu343726/edalib/Map.h>
 #include <manu343726/edalib/Set.h>
 #include <manu343726/edalib/BinTree.h>
+#include <manu343726/edalib/StaticTreeMap.h>
+#include <manu343726/edalib/SplayTreeMap.h>
+#include <manu343726/edalib/ConcurrentSkipListMap.h>
+#include <manu343726/edalib/PersistentTreeMap.h>
+#include <manu343726/edalib/IntervalTree.h>
+#include <manu343726/edalib/RoaringBitmap.h>
+#include <manu343726/edalib/Cache.h>
 //#define EDALIB_FIBHEAP_TIMING
 //#define EDALIB_FIBHEAP_TIMING_INTERNALS
 #define EDALIB_FIBHEAP_CHECKS
@@ -197,6 +209,1322 @@ void testContainerAdapter() {
     });
 }
 
+/**
+ * Checks that an ordered map holds exactly the given keys (with key*key as value), in order
+ */
+template<typename M>
+bool sameKeys(const M& map, std::vector<int> keys)
+{
+    std::sort(std::begin(keys), std::end(keys));
+    
+    std::size_t i = 0;
+    for (auto it = map.begin(); it != map.end(); it.next(), ++i)
+    {
+        if (i >= keys.size() || it.key() != keys[i] || it.value() != keys[i]*keys[i])
+            return false;
+    }
+    
+    return i == keys.size() && map.size() == keys.size();
+}
+
+template<template<typename,typename> class M, std::size_t SIZE>
+void testOrderedMap(const std::vector<int>& keys)
+{
+    M<int,int> map;
+    
+    it("Inserts correctly", [&]()
+    {
+        for (int k : keys)
+            map.insert(k, k*k);
+        
+        AssertThat(sameKeys(map, keys), Is().True());
+    });
+    
+    it("Overwrites values of existing keys", [&]()
+    {
+        map.insert(keys.front(), 0);
+        AssertThat(map.at(keys.front()), Is().EqualTo(0));
+        AssertThat(map.size(), Is().EqualTo(SIZE));
+        map.insert(keys.front(), keys.front()*keys.front());
+    });
+    
+    it("Finds every key", [&]()
+    {
+        for (int k : keys)
+        {
+            auto it = map.find(k);
+            AssertThat(it != map.end(), Is().True());
+            AssertThat(it.key(), Is().EqualTo(k));
+        }
+        
+        AssertThat(map.find((int)SIZE) == map.end(), Is().True());
+    });
+    
+    it("Erases correctly", [&]()
+    {
+        std::vector<int> remaining;
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+            if (i % 2)
+                map.erase(keys[i]);
+            else
+                remaining.push_back(keys[i]);
+        }
+        
+        AssertThat(sameKeys(map, remaining), Is().True());
+    });
+    
+    it("Can be copied", [&]()
+    {
+        M<int,int> copy(map);
+        map.insert((int)SIZE, 0);
+        
+        AssertThat(copy.size(), Is().EqualTo(map.size() - 1));
+        AssertThat(copy.find((int)SIZE) == copy.end(), Is().True());
+        map.erase((int)SIZE);
+        
+        auto a = copy.begin();
+        auto b = map.begin();
+        for (; a != copy.end() && b != map.end(); a.next(), b.next())
+            AssertThat(a.key(), Is().EqualTo(b.key()));
+        AssertThat(a == copy.end() && b == map.end(), Is().True());
+    });
+    
+    it("Erases every key", [&]()
+    {
+        for (std::size_t i = 0; i < keys.size(); i += 2)
+            map.erase(keys[i]);
+        
+        AssertThat(map.size(), Is().EqualTo(0));
+        AssertThat(map.begin() == map.end(), Is().True());
+    });
+}
+
+/**
+ * Whether a tree height is within the AVL bound for a given number of nodes
+ */
+bool isAVLHeight(std::size_t height, std::size_t nodes)
+{
+    return height <= 1.44 * std::log2(nodes + 2);
+}
+
+template<template<typename,typename> class M, std::size_t SIZE>
+void testTreeBalance(const std::vector<int>& keys)
+{
+    M<int,int> map;
+    
+    it("Stays balanced while inserting", [&]()
+    {
+        for (int k : keys)
+        {
+            map.insert(k, k);
+            AssertThat(isAVLHeight(map.height(), map.size()), Is().True());
+        }
+        AssertThat(map.size(), Is().EqualTo(SIZE));
+    });
+    
+    it("Stays balanced while erasing", [&]()
+    {
+        for (std::size_t i = 1; i < keys.size(); i += 2)
+        {
+            map.erase(keys[i]);
+            AssertThat(isAVLHeight(map.height(), map.size()), Is().True());
+        }
+        AssertThat(map.size(), Is().EqualTo(SIZE / 2));
+    });
+}
+
+void testTreeMapIterators()
+{
+    edatocpp_container_adapter<TreeMap<int,int>> map;
+    
+    for (int i = 0; i < 100; ++i)
+        map.insert(i, i*i);
+    
+    it("Is a bidirectional iterator", [&]()
+    {
+        typedef typename decltype(map.begin())::iterator_category category;
+        AssertThat((std::is_same<category, std::bidirectional_iterator_tag>::value), Is().True());
+    });
+    
+    it("Walks backwards from the end", [&]()
+    {
+        int expected = 99;
+        for (auto it = map.end(); it != map.begin(); --expected)
+        {
+            --it;
+            AssertThat((*it).first, Is().EqualTo(expected));
+        }
+        AssertThat(expected, Is().EqualTo(-1));
+    });
+    
+    it("Works with std algorithms", [&]()
+    {
+        auto last = std::find_if(std::reverse_iterator<decltype(map.end())>(map.end()), 
+                                 std::reverse_iterator<decltype(map.begin())>(map.begin()),
+                                 [](const std::pair<const int,int>& e){ return e.first % 7 == 0; });
+        
+        AssertThat((*last).first, Is().EqualTo(98));
+        AssertThat(std::distance(map.begin(), map.end()), Is().EqualTo(100));
+    });
+}
+
+/**
+ * Collects the keys of an iterable range
+ */
+template<typename R>
+std::vector<int> keysIn(const R& range)
+{
+    std::vector<int> keys;
+    for (auto it = range.begin(); it != range.end(); it.next())
+        keys.push_back(it.key());
+    return keys;
+}
+
+void testTreeMapRanges()
+{
+    TreeMap<int,int> map;
+    
+    for (int i = 0; i < 100; ++i)
+        map.insert(2*i, i);
+    
+    it("Finds lower and upper bounds", [&]()
+    {
+        AssertThat(map.lower_bound(10).key(), Is().EqualTo(10));
+        AssertThat(map.lower_bound(11).key(), Is().EqualTo(12));
+        AssertThat(map.upper_bound(10).key(), Is().EqualTo(12));
+        AssertThat(map.lower_bound(-5) == map.begin(), Is().True());
+        AssertThat(map.lower_bound(199) == map.end(), Is().True());
+        AssertThat(map.upper_bound(198) == map.end(), Is().True());
+    });
+    
+    it("Finds equal ranges", [&]()
+    {
+        AssertThat(keysIn(map.equal_range(10)), Is().EqualTo(std::vector<int>{ 10 }));
+        AssertThat(keysIn(map.equal_range(11)).empty(), Is().True());
+    });
+    
+    it("Iterates half-open ranges", [&]()
+    {
+        AssertThat(keysIn(map.range(9, 16)), Is().EqualTo(std::vector<int>{ 10, 12, 14 }));
+        AssertThat(keysIn(map.range(190, 1000)), Is().EqualTo(std::vector<int>{ 190, 192, 194, 196, 198 }));
+        AssertThat(keysIn(map.range(16, 9)).empty(), Is().True());
+    });
+    
+    it("Erases ranges", [&]()
+    {
+        AssertThat(map.erase_range(10, 190), Is().EqualTo(90));
+        AssertThat(map.size(), Is().EqualTo(10));
+        AssertThat(keysIn(map.range(0, 1000)), Is().EqualTo(std::vector<int>{ 0, 2, 4, 6, 8, 190, 192, 194, 196, 198 }));
+    });
+}
+
+void testTreeMapOrderStatistics()
+{
+    TreeMap<int,int> map;
+    std::vector<int> keys(200);
+    std::iota(std::begin(keys), std::end(keys), 0);
+    std::shuffle(std::begin(keys), std::end(keys), std::default_random_engine{});
+    
+    for (int k : keys)
+        map.insert(3*k, k);
+    
+    it("Ranks keys", [&]()
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            AssertThat(map.rank(3*i), Is().EqualTo(i));
+            AssertThat(map.rank(3*i + 1), Is().EqualTo(i + 1));
+        }
+        AssertThat(map.rank(-1), Is().EqualTo(0));
+    });
+    
+    it("Selects entries by position", [&]()
+    {
+        for (int i = 0; i < 200; ++i)
+            AssertThat(map.select(i).key(), Is().EqualTo(3*i));
+        AssertThat(map.select(200) == map.end(), Is().True());
+    });
+    
+    it("Counts entries in ranges", [&]()
+    {
+        AssertThat(map.count(0, 600), Is().EqualTo(200));
+        AssertThat(map.count(1, 10), Is().EqualTo(3));
+        AssertThat(map.count(10, 1), Is().EqualTo(0));
+    });
+    
+    it("Keeps counts through removals", [&]()
+    {
+        for (int i = 0; i < 200; i += 2)
+            map.erase(3*i);
+        map.erase_range(300, 450);
+        
+        AssertThat(map.count(0, 600), Is().EqualTo(map.size()));
+        AssertThat(map.select(50).key(), Is().EqualTo(453)); // 50 odd multiples of 3 below 300, then 3*151
+        AssertThat(map.rank(map.select(60).key()), Is().EqualTo(60));
+    });
+}
+
+void testTreeMapCompare()
+{
+    it("Sorts keys with the given ordering", [&]()
+    {
+        TreeMap<int,int,std::greater<int>> map;
+        for (int i = 0; i < 100; ++i)
+            map.insert((i * 37) % 100, i);
+        map.erase(50);
+        
+        int expected = 99;
+        for (auto it = map.begin(); it != map.end(); it.next(), --expected)
+        {
+            expected -= expected == 50 ? 1 : 0;
+            AssertThat(it.key(), Is().EqualTo(expected));
+        }
+        AssertThat(map.lower_bound(50).key(), Is().EqualTo(49));
+        AssertThat(map.rank(10), Is().EqualTo(88));
+        AssertThat(map.at(37), Is().EqualTo(1));
+    });
+    
+    it("Compares strings three ways, shortest first on equal prefixes", [&]()
+    {
+        std::vector<std::string> keys { "", "a", "ab", "abc", "abd", "b", std::string("a\0b", 3), "\xff" };
+        TreeMap<std::string,int> map;
+        for (std::size_t i = 0; i < keys.size(); ++i)
+            map.insert(keys[i], (int)i);
+        std::sort(keys.begin(), keys.end());
+        
+        std::vector<std::string> sorted;
+        for (auto it = map.begin(); it != map.end(); it.next())
+            sorted.push_back(it.key());
+        AssertThat(sorted, Is().EqualTo(keys));
+        for (const auto& a : keys)
+            for (const auto& b : keys)
+            {
+                int order = ThreeWayCompare<std::string, std::less<std::string>>::compare(std::less<std::string>(), a, b);
+                AssertThat(order < 0, Is().EqualTo(a < b));
+                AssertThat(order > 0, Is().EqualTo(b < a));
+            }
+    });
+}
+
+/**
+ * Checks that a TreeMap holds exactly the given keys, walking it forwards,
+ * backwards and by position (so that parents and counts are checked too)
+ */
+bool sameKeys(const TreeMap<int,int>& map, const std::set<int>& keys)
+{
+    std::vector<int> sorted(keys.begin(), keys.end()), forwards, backwards;
+    for (auto it = map.begin(); it != map.end(); it.next())
+        forwards.push_back(it.key());
+    if (map.size() != 0)
+        for (auto it = map.end(); it != map.begin(); )
+        {
+            it.prev();
+            backwards.push_back(it.key());
+        }
+    std::reverse(backwards.begin(), backwards.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i)
+        if (map.select(i).key() != sorted[i])
+            return false;
+    return forwards == sorted && backwards == sorted && map.size() == sorted.size();
+}
+
+void testTreeMapSetAlgebra()
+{
+    std::default_random_engine random(3);
+    auto randomMap = [&](std::size_t size, int range, std::set<int>& keys)
+    {
+        TreeMap<int,int> map;
+        std::uniform_int_distribution<int> distribution(0, range - 1);
+        while (keys.size() < size)
+        {
+            int k = distribution(random);
+            keys.insert(k);
+            map.insert(k, k);
+        }
+        return map;
+    };
+    
+    it("Unites, intersects and subtracts maps of any sizes", [&]()
+    {
+        for (std::size_t size : { 0, 1, 10, 300 })
+            for (std::size_t otherSize : { 0, 1, 50, 2000 })
+                for (unsigned threads : { 1, 4 })
+                {
+                    std::set<int> a, b;
+                    TreeMap<int,int> united = randomMap(size, 5000, a);
+                    TreeMap<int,int> other = randomMap(otherSize, 5000, b);
+                    TreeMap<int,int> intersected(united), subtracted(united);
+                    
+                    united.union_with(other, threads, 16);
+                    intersected.intersect_with(other, threads, 16);
+                    subtracted.difference_with(other, threads, 16);
+                    
+                    std::set<int> u(a), i, d;
+                    u.insert(b.begin(), b.end());
+                    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(i, i.end()));
+                    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(d, d.end()));
+                    AssertThat(sameKeys(united, u), Is().True());
+                    AssertThat(sameKeys(intersected, i), Is().True());
+                    AssertThat(sameKeys(subtracted, d), Is().True());
+                    AssertThat(sameKeys(other, b), Is().True());
+                }
+    });
+    
+    it("Takes the values of the other map on union, and keeps its own otherwise", [&]()
+    {
+        TreeMap<int,int> map, other;
+        for (int i = 0; i < 10; ++i)
+        {
+            map.insert(i, 1);
+            other.insert(i + 5, 2);
+        }
+        TreeMap<int,int> intersected(map);
+        map.union_with(other);
+        intersected.intersect_with(other);
+        
+        AssertThat(map.at(4), Is().EqualTo(1));
+        AssertThat(map.at(5), Is().EqualTo(2));
+        AssertThat(intersected.at(5), Is().EqualTo(1));
+        map.difference_with(map);
+        AssertThat(map.size(), Is().EqualTo(0));
+        
+        Map<int,int>::T a, b;
+        a.insert(1, 1);
+        b.insert(2, 2);
+        a.union_with(b);
+        AssertThat(a.size(), Is().EqualTo(2));
+    });
+}
+
+/**
+ * Checks that a set holds exactly the given elements
+ */
+template<typename S>
+bool sameElements(const S& set, const std::set<int>& elements)
+{
+    for (int e : elements)
+        if (!set.contains(e))
+            return false;
+    return set.size() == elements.size();
+}
+
+/** a TreeMap sorted the other way round, to check that set algebra follows the map's ordering */
+template<class K, class V>
+using DescendingTreeMap = TreeMap<K, V, std::greater<K>>;
+
+template<typename S>
+void testSetAlgebra()
+{
+    S a, b, big;
+    std::set<int> ea, eb, ebig;
+    for (int i = 0; i < 300; ++i)
+    {
+        a.insert(i * 3 % 500);
+        ea.insert(i * 3 % 500);
+        b.insert(i * 5 % 700);
+        eb.insert(i * 5 % 700);
+    }
+    for (int i = 0; i < 50000; ++i)
+    {
+        big.insert(i * 2);
+        ebig.insert(i * 2);
+    }
+    
+    auto expect = [](const std::set<int>& x, const std::set<int>& y, bool inX, bool inY)
+    {
+        std::set<int> result;
+        for (int e : x)
+            if (inX && (y.count(e) != 0) == inY)
+                result.insert(e);
+        for (int e : y)
+            if (!inX && inY && !x.count(e))
+                result.insert(e);
+        return result;
+    };
+    
+    it("Unites, intersects and subtracts sets", [&]()
+    {
+        std::set<int> u(ea);
+        u.insert(eb.begin(), eb.end());
+        AssertThat(sameElements(set_union(a, b), u), Is().True());
+        AssertThat(sameElements(set_intersection(a, b), expect(ea, eb, true, true)), Is().True());
+        AssertThat(sameElements(set_difference(a, b), expect(ea, eb, true, false)), Is().True());
+        AssertThat(sameElements(set_difference(b, a), expect(eb, ea, true, false)), Is().True());
+    });
+    
+    it("Does it in place, and with several threads", [&]()
+    {
+        for (unsigned threads : { 1, 4 })
+        {
+            S u(a), i(a), d(big);
+            u.union_with(big, threads);
+            i.intersect_with(big, threads);
+            d.difference_with(a, threads);
+            std::set<int> eu(ea);
+            eu.insert(ebig.begin(), ebig.end());
+            AssertThat(sameElements(u, eu), Is().True());
+            AssertThat(sameElements(i, expect(ea, ebig, true, true)), Is().True());
+            AssertThat(sameElements(d, expect(ebig, ea, true, false)), Is().True());
+            AssertThat(sameElements(set_intersection(big, a, threads), expect(ea, ebig, true, true)), Is().True());
+            AssertThat(sameElements(set_difference(big, a, threads), expect(ebig, ea, true, false)), Is().True());
+            AssertThat(sameElements(set_difference(a, big, threads), expect(ea, ebig, true, false)), Is().True());
+        }
+    });
+    
+    it("Checks subsets", [&]()
+    {
+        S evens;
+        for (int i = 0; i < 500; i += 2)
+            evens.insert(i);
+        AssertThat(is_subset(evens, big), Is().True());
+        AssertThat(is_subset(evens, big, 4), Is().True());
+        AssertThat(is_subset(a, big), Is().False());
+        AssertThat(is_subset(big, evens), Is().False());
+        AssertThat(is_subset(S(), a), Is().True());
+        AssertThat(is_subset(a, a), Is().True());
+    });
+}
+
+void testTreeMapFromSorted()
+{
+    std::vector<std::pair<int,int>> entries;
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i)
+    {
+        entries.push_back(std::make_pair(i, i*i));
+        keys.push_back(i);
+    }
+    
+    auto map = TreeMap<int,int>::from_sorted(std::begin(entries), std::end(entries));
+    
+    it("Builds from sorted entries", [&]()
+    {
+        AssertThat(sameKeys(map, keys), Is().True());
+        AssertThat(map.select(500).key(), Is().EqualTo(500));
+    });
+    
+    it("Builds a tree that can be updated", [&]()
+    {
+        map.insert(1000, 1000*1000);
+        keys.push_back(1000);
+        map.erase(0);
+        keys.erase(std::begin(keys));
+        
+        AssertThat(sameKeys(map, keys), Is().True());
+    });
+    
+    it("Builds empty maps", [&]()
+    {
+        auto empty = TreeMap<int,int>::from_sorted(std::begin(entries), std::begin(entries));
+        AssertThat(empty.size(), Is().EqualTo(0));
+        AssertThat(empty.begin() == empty.end(), Is().True());
+    });
+}
+
+void testBinTreeParallel()
+{
+    const int size = 10000;
+    std::vector<int> elems(size);
+    std::iota(std::begin(elems), std::end(elems), 0);
+    
+    BinTree<int> t;
+    auto first = std::begin(elems);
+    t._root = t.buildBalanced(first, elems.size());
+    
+    it("Reduces subtrees in parallel, in in-order", [&]()
+    {
+        for (unsigned threads : { 1u, 2u, 3u, 8u })
+        {
+            long long sum = BinTree<int>::parallel_reduce(t._root, 
+                [](int e) { return (long long)e; }, std::plus<long long>(), threads, 16);
+            AssertThat(sum, Is().EqualTo((long long)size * (size - 1) / 2));
+            
+            auto concatenated = BinTree<int>::parallel_reduce(t._root, 
+                [](int e) { return std::vector<int>{ e }; }, 
+                [](std::vector<int> a, const std::vector<int>& b) { a.insert(a.end(), b.begin(), b.end()); return a; }, 
+                threads, 16);
+            AssertThat(concatenated, Is().EqualTo(elems));
+        }
+        AssertThat(BinTree<int>::parallel_reduce(nullptr, [](int e) { return e; }, std::plus<int>()), Is().EqualTo(0));
+    });
+    
+    it("Visits every element once in parallel", [&]()
+    {
+        BinTree<int>::parallel_for_each(t._root, [](int& e) { e *= 2; }, 8, 16);
+        std::vector<int> doubled;
+        t.inorder(doubled, t._root);
+        for (int i = 0; i < size; ++i)
+            AssertThat(doubled[i], Is().EqualTo(2 * i));
+    });
+}
+
+void testBinTreeDegenerate()
+{
+    const std::size_t size = 1000000;
+    
+    it("Copies and destroys degenerate trees without overflowing the stack", [&]()
+    {
+        BinTree<int> t;
+        for (std::size_t i = 0; i < size; ++i)
+            t._root = t.createNode((int)i, (i % 2) ? t._root : 0, (i % 2) ? 0 : t._root);
+        
+        BinTree<int> copy(t);
+        AssertThat(copy._root->_count, Is().EqualTo(size));
+        AssertThat(copy._root->_height, Is().EqualTo((int)size));
+        
+        auto a = BinTree<int>::firstInOrder(t._root);
+        auto b = BinTree<int>::firstInOrder(copy._root);
+        for (; a && b; a = BinTree<int>::nextInOrder(a), b = BinTree<int>::nextInOrder(b))
+            AssertThat(a->_elem, Is().EqualTo(b->_elem));
+        AssertThat(a == nullptr && b == nullptr, Is().True());
+    });
+}
+
+void testSplayTreeMap()
+{
+    it("Keeps iterators valid while lookups splay the tree", [&]()
+    {
+        SplayTreeMap<int,int> map;
+        for (int i = 0; i < 100; ++i)
+            map.insert((i * 37) % 100, i);
+        
+        int expected = 0;
+        for (auto it = map.begin(); it != map.end(); it.next(), ++expected)
+        {
+            AssertThat(it.key(), Is().EqualTo(expected));
+            map.find((expected * 53) % 100);
+            map.find(-1);
+        }
+        AssertThat(expected, Is().EqualTo(100));
+        AssertThrows(SplayTreeMapNoSuchElement, map.erase(100));
+    });
+    
+    it("Backs maps and sets", [&]()
+    {
+        Map<int,int>::S map;
+        Set<int>::S set;
+        for (int i = 0; i < 10; ++i)
+        {
+            map.insert(i, -i);
+            set.insert(i);
+        }
+        set.erase(3);
+        AssertThat(map.at(3), Is().EqualTo(-3));
+        AssertThat(set.contains(3), Is().False());
+        AssertThat(set.contains(4), Is().True());
+        AssertThat(set.size(), Is().EqualTo(9));
+    });
+}
+
+template<typename M>
+void testMultiMap(bool ordered)
+{
+    it("Keeps every value of a key, in insertion order", [&]()
+    {
+        M map;
+        std::multimap<int,int> expected;
+        std::default_random_engine random(7);
+        std::uniform_int_distribution<int> keys(0, 99);
+        for (int i = 0; i < 2000; ++i)
+        {
+            int key = keys(random);
+            map.insert(key, i);
+            expected.insert(std::make_pair(key, i));
+            if (i % 100 == 99)
+            {
+                key = keys(random);
+                AssertThat(map.erase(key), Is().EqualTo(expected.erase(key)));
+            }
+        }
+        AssertThat(map.size(), Is().EqualTo(expected.size()));
+        
+        for (int key = -1; key <= 100; ++key)
+        {
+            auto range = map.equal_range(key);
+            auto e = expected.equal_range(key);
+            std::vector<int> values, expectedValues;
+            for (auto it = range.begin(); it != range.end(); it.next())
+            {
+                AssertThat(it.key(), Is().EqualTo(key));
+                values.push_back(it.value());
+            }
+            for (; e.first != e.second; ++e.first)
+                expectedValues.push_back(e.first->second);
+            AssertThat(values == expectedValues, Is().True());
+            AssertThat(map.count(key), Is().EqualTo(expected.count(key)));
+            AssertThat(map.contains(key), Is().EqualTo(expected.count(key) > 0));
+        }
+        
+        std::size_t visited = 0;
+        int last = -1;
+        for (auto it = map.begin(); it != map.end(); it.next(), ++visited)
+        {
+            if (ordered)
+                AssertThat(it.key() >= last, Is().True());
+            last = it.key();
+        }
+        AssertThat(visited, Is().EqualTo(expected.size()));
+        
+        AssertThat(map.erase(-1), Is().EqualTo(0u));
+        for (int key = 0; key < 100; ++key)
+            map.erase(key);
+        AssertThat(map.size(), Is().EqualTo(0u));
+        AssertThat(map.begin() == map.end(), Is().True());
+    });
+}
+
+template<typename S>
+void testMultiSet()
+{
+    it("Counts and erases every copy of an element", [&]()
+    {
+        S set;
+        for (int i = 0; i < 30; ++i)
+            set.insert(i % 7);
+        AssertThat(set.size(), Is().EqualTo(30u));
+        AssertThat(set.count(1), Is().EqualTo(5u));
+        AssertThat(set.count(2), Is().EqualTo(4u));
+        set.erase(2);
+        AssertThat(set.count(2), Is().EqualTo(0u));
+        AssertThat(set.contains(2), Is().False());
+        AssertThat(set.size(), Is().EqualTo(26u));
+        
+        typename Set<int>::T plain;
+        plain.insert(3);
+        plain.insert(3);
+        AssertThat(plain.count(3), Is().EqualTo(1u));
+        AssertThat(plain.count(4), Is().EqualTo(0u));
+    });
+}
+
+void testConcurrentSkipListMap()
+{
+    it("Takes insertions and removals from many threads at once", [&]()
+    {
+        const int threads = 4, perThread = 5000;
+        ConcurrentSkipListMap<int,int> map;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&map, t]()
+            {
+                for (int i = 0; i < perThread; ++i)
+                    map.insert(i * threads + t, i);
+                for (int i = 0; i < perThread; i += 2)
+                    map.erase(i * threads + t);
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+        
+        AssertThat(map.size(), Is().EqualTo((std::size_t)threads * perThread / 2));
+        int last = -1, count = 0;
+        for (auto it = map.begin(); it != map.end(); it.next(), ++count)
+        {
+            AssertThat(it.key(), Is().GreaterThan(last));
+            AssertThat(it.value() % 2, Is().EqualTo(1));
+            last = it.key();
+        }
+        AssertThat(count, Is().EqualTo(threads * perThread / 2));
+        
+        map.compact();
+        AssertThat(map.at(1 * threads + 3), Is().EqualTo(1));
+        AssertThat(map.find(0) == map.end(), Is().True());
+        AssertThrows(ConcurrentSkipListMapNoSuchElement, map.erase(0));
+    });
+}
+
+void testPersistentTreeMap()
+{
+    it("Keeps snapshots unchanged while the map changes", [&]()
+    {
+        PersistentTreeMap<int,int> map;
+        std::vector<PersistentTreeMap<int,int>> versions;
+        std::vector<std::vector<int>> keys(1);
+        for (int i = 0; i < 200; ++i)
+        {
+            versions.push_back(map);
+            keys.push_back(keys.back());
+            int k = (i * 37) % 101;
+            if (map.find(k) != map.end())
+            {
+                map.erase(k);
+                keys.back().erase(std::find(keys.back().begin(), keys.back().end(), k));
+            }
+            else
+            {
+                map.insert(k, k*k);
+                keys.back().push_back(k);
+            }
+        }
+        versions.push_back(map);
+        map = PersistentTreeMap<int,int>();
+        
+        for (std::size_t v = 0; v < versions.size(); v += 3)
+            versions[v] = PersistentTreeMap<int,int>();
+        for (std::size_t v = 0; v < versions.size(); ++v)
+            AssertThat(sameKeys(versions[v], v % 3 ? keys[v] : std::vector<int>()), Is().True());
+    });
+    
+    it("Returns new versions, leaving the old ones alone", [&]()
+    {
+        PersistentTreeMap<int,int> empty;
+        auto one = empty.inserted(1, 1);
+        auto two = one.inserted(2, 4);
+        auto other = two.erased(1).inserted(2, 0);
+        
+        AssertThat(empty.size(), Is().EqualTo(0));
+        AssertThat(sameKeys(one, std::vector<int>{ 1 }), Is().True());
+        AssertThat(sameKeys(two, std::vector<int>{ 1, 2 }), Is().True());
+        AssertThat(other.size(), Is().EqualTo(1));
+        AssertThat(other.at(2), Is().EqualTo(0));
+        AssertThat(other.lower_bound(0).key(), Is().EqualTo(2));
+        AssertThrows(PersistentTreeMapNoSuchElement, one.erased(2));
+    });
+    
+    it("Can be read from many threads while it changes", [&]()
+    {
+        PersistentTreeMap<int,int> map;
+        for (int i = 0; i < 1000; ++i)
+            map.insert(i, i*i);
+        
+        std::vector<std::thread> readers;
+        std::vector<int> sums(4);
+        for (int t = 0; t < 4; ++t)
+        {
+            PersistentTreeMap<int,int> snapshot(map);
+            readers.emplace_back([snapshot, t, &sums]()
+            {
+                for (auto it = snapshot.begin(); it != snapshot.end(); it.next())
+                    sums[t] += it.key();
+            });
+            for (int i = 0; i < 1000; i += 2)
+                map.insert(i, 0);
+            map.erase(t);
+        }
+        for (auto& r : readers)
+            r.join();
+        
+        AssertThat(sums, Is().EqualTo(std::vector<int>{ 499500, 499500, 499499, 499497 }));
+    });
+}
+
+void testBloomFilter()
+{
+    it("Has no false negatives, and few false positives", [&]()
+    {
+        const std::size_t n = 10000;
+        BlockedBloomFilter filter(n);
+        for (std::size_t i = 0; i < n; ++i)
+            filter.add(i);
+        std::size_t falsePositives = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            AssertThat(filter.mayContain(i), Is().True());
+            falsePositives += filter.mayContain(n + i);
+        }
+        AssertThat(falsePositives, Is().LessThan(n / 50));
+        filter.clear();
+        AssertThat(filter.mayContain(0), Is().False());
+    });
+    
+    it("Keeps filtered lookups exact through erasures, growth and copies", [&]()
+    {
+        Set<std::string>::HF set;
+        std::set<std::string> expected;
+        std::default_random_engine random(3);
+        std::uniform_int_distribution<int> keys(0, 3999);
+        for (int i = 0; i < 30000; ++i)
+        {
+            std::string key = "key" + std::to_string(keys(random));
+            if (i % 3 == 0 && expected.count(key))
+            {
+                set.erase(key);
+                expected.erase(key);
+            }
+            else
+            {
+                set.insert(key);
+                expected.insert(key);
+            }
+            AssertThat(set.contains(key), Is().EqualTo(expected.count(key) > 0));
+        }
+        AssertThat(set.size(), Is().EqualTo(expected.size()));
+        for (int i = 0; i < 4000; ++i)
+        {
+            std::string key = "key" + std::to_string(i);
+            AssertThat(set.contains(key), Is().EqualTo(expected.count(key) > 0));
+        }
+        
+        Map<int,int>::HF map;
+        for (int i = 0; i < 1000; ++i)
+            map.insert(i, -i);
+        Map<int,int>::HF copy(map);
+        for (int i = 0; i < 1000; i += 2)
+            map.erase(i);
+        AssertThat(map.contains(2), Is().False());
+        AssertThat(copy.at(2), Is().EqualTo(-2));
+        AssertThat(map.at(3), Is().EqualTo(-3));
+        AssertThrows(HashTableNoSuchElement, map.at(1000));
+        AssertThrows(HashTableNoSuchElement, map.erase(2));
+    });
+}
+
+void testRoaringBitmap()
+{
+    RoaringBitmap<int> bitmap;
+    std::set<int> expected;
+    std::default_random_engine random(11);
+    // negative and sparse keys, keys dense enough for a bitmap, and a long range
+    std::uniform_int_distribution<int> sparse(-(1 << 30), 1 << 30), dense(1 << 20, (1 << 20) + 20000);
+    auto add = [&](int key)
+    {
+        bitmap.insert(key);
+        expected.insert(key);
+    };
+    for (int i = 0; i < 3000; ++i)
+        add(sparse(random));
+    for (int i = 0; i < 15000; ++i)
+        add(dense(random));
+    for (int key = 5 << 16; key < (5 << 16) + 30000; ++key)
+        add(key);
+    
+    auto same = [&](const RoaringBitmap<int>& b, const std::set<int>& e)
+    {
+        std::vector<int> keys;
+        for (auto it = b.begin(); it != b.end(); it.next())
+            keys.push_back(it.key());
+        return b.size() == e.size() && keys == std::vector<int>(e.begin(), e.end());
+    };
+    
+    it("Iterates its keys in order", [&]()
+    {
+        AssertThat(same(bitmap, expected), Is().True());
+    });
+    
+    it("Finds its keys", [&]()
+    {
+        for (int key = (1 << 20) - 100; key < (1 << 20) + 100; ++key)
+            AssertThat(bitmap.contains(key), Is().EqualTo(expected.count(key) == 1));
+        for (int key : expected)
+        {
+            auto it = bitmap.find(key);
+            AssertThat(it.key(), Is().EqualTo(key));
+            it.next();
+            auto next = expected.upper_bound(key);
+            AssertThat(it == bitmap.end(), Is().EqualTo(next == expected.end()));
+            if (next != expected.end())
+                AssertThat(it.key(), Is().EqualTo(*next));
+        }
+        AssertThat(bitmap.find(-1) == bitmap.end(), Is().EqualTo(expected.count(-1) == 0));
+    });
+    
+    it("Keeps changing once optimized into runs", [&]()
+    {
+        std::size_t bytes = bitmap.bytes();
+        bitmap.optimize();
+        AssertThat(bitmap.bytes(), Is().LessThan(bytes));
+        AssertThat(same(bitmap, expected), Is().True());
+        for (int key = (5 << 16) + 100; key < (5 << 16) + 30000; key += 100)
+        {
+            bitmap.erase(key);
+            expected.erase(key);
+        }
+        for (int key = (5 << 16) + 100; key < (5 << 16) + 15000; key += 100)
+            add(key);
+        add((5 << 16) + 30000);
+        add((5 << 16) - 1);
+        AssertThat(same(bitmap, expected), Is().True());
+    });
+    
+    it("Removes keys", [&]()
+    {
+        std::vector<int> keys(expected.begin(), expected.end());
+        for (std::size_t i = 0; i < keys.size(); i += 2)
+        {
+            bitmap.erase(keys[i]);
+            expected.erase(keys[i]);
+        }
+        AssertThat(same(bitmap, expected), Is().True());
+        AssertThrows(RoaringBitmapNoSuchElement, bitmap.erase(keys[0]));
+    });
+    
+    it("Unites, intersects and subtracts bitmaps", [&]()
+    {
+        RoaringBitmap<int> other;
+        std::set<int> eother;
+        for (int key = (1 << 20) - 5000; key < (1 << 20) + 40000; key += 3)
+        {
+            other.insert(key);
+            eother.insert(key);
+        }
+        for (int key = (5 << 16) + 10000; key < (6 << 16) + 10; ++key)
+        {
+            other.insert(key);
+            eother.insert(key);
+        }
+        other.optimize();
+        
+        std::set<int> u, i, d;
+        std::set_union(expected.begin(), expected.end(), eother.begin(), eother.end(), std::inserter(u, u.end()));
+        std::set_intersection(expected.begin(), expected.end(), eother.begin(), eother.end(), std::inserter(i, i.end()));
+        std::set_difference(expected.begin(), expected.end(), eother.begin(), eother.end(), std::inserter(d, d.end()));
+        RoaringBitmap<int> bu(bitmap), bi(bitmap), bd(bitmap);
+        bu.union_with(other);
+        bi.intersect_with(other);
+        bd.difference_with(other);
+        AssertThat(same(bu, u), Is().True());
+        AssertThat(same(bi, i), Is().True());
+        AssertThat(same(bd, d), Is().True());
+        bd.difference_with(bd);
+        AssertThat(bd.size(), Is().EqualTo(0u));
+    });
+}
+
+void testCache()
+{
+    it("Evicts the least recently used entry", [&]()
+    {
+        Cache<int,int,LRUPolicy> cache(3);
+        for (int i = 1; i <= 3; ++i)
+            cache.put(i, -i);
+        AssertThat(*cache.get(1), Is().EqualTo(-1));
+        cache.put(4, -4);
+        AssertThat(cache.contains(2), Is().False());
+        AssertThat(cache.get(2) == 0, Is().True());
+        AssertThat(cache.size(), Is().EqualTo(3u));
+        AssertThat(cache.hits(), Is().EqualTo(1u));
+        AssertThat(cache.misses(), Is().EqualTo(1u));
+    });
+    
+    it("Evicts the least frequently used entry", [&]()
+    {
+        Cache<int,int,LFUPolicy> cache(3);
+        for (int i = 1; i <= 3; ++i)
+            cache.put(i, -i);
+        cache.get(1);
+        cache.get(1);
+        cache.get(2);
+        cache.put(4, -4);
+        AssertThat(cache.contains(3), Is().False());
+        cache.get(4);
+        cache.put(5, -5);
+        // 2 and 4 had a hit each; 2 was used longer ago
+        AssertThat(cache.contains(2), Is().False());
+        AssertThat(cache.contains(1), Is().True());
+        AssertThat(cache.contains(4), Is().True());
+    });
+    
+    it("Gives used entries a second chance", [&]()
+    {
+        Cache<int,int,ClockPolicy> cache(3);
+        for (int i = 1; i <= 3; ++i)
+            cache.put(i, -i);
+        cache.get(1);
+        cache.put(4, -4);
+        AssertThat(cache.contains(1), Is().True());
+        AssertThat(cache.contains(2), Is().False());
+        cache.put(5, -5);
+        AssertThat(cache.contains(3), Is().False());
+        AssertThat(cache.erase(1), Is().True());
+        AssertThat(cache.erase(1), Is().False());
+        AssertThat(cache.size(), Is().EqualTo(2u));
+    });
+    
+    it("Stays within its capacity by weight", [&]()
+    {
+        Cache<std::string,int> cache(10);
+        cache.put("a", 1, 4);
+        cache.put("b", 2, 4);
+        cache.put("c", 3, 4);
+        AssertThat(cache.contains("a"), Is().False());
+        AssertThat(cache.weight(), Is().EqualTo(8u));
+        cache.put("b", 20, 9);
+        AssertThat(cache.contains("c"), Is().False());
+        AssertThat(*cache.get("b"), Is().EqualTo(20));
+        AssertThat(cache.weight(), Is().EqualTo(9u));
+        AssertThrows(CacheOverweight, cache.put("d", 4, 11));
+    });
+    
+    it("Matches a list-based LRU", [&]()
+    {
+        const std::size_t capacity = 50;
+        Cache<int,int> cache(capacity);
+        std::list<int> order;
+        std::map<int, std::pair<int, std::list<int>::iterator>> expected;
+        std::default_random_engine random(11);
+        std::uniform_int_distribution<int> keys(0, 199);
+        for (int i = 0; i < 20000; ++i)
+        {
+            int key = keys(random);
+            auto e = expected.find(key);
+            if (i % 7 == 0)
+            {
+                AssertThat(cache.erase(key), Is().EqualTo(e != expected.end()));
+                if (e != expected.end())
+                {
+                    order.erase(e->second.second);
+                    expected.erase(e);
+                }
+            }
+            else if (i % 3 == 0)
+            {
+                cache.put(key, i);
+                if (e != expected.end())
+                {
+                    order.erase(e->second.second);
+                    expected.erase(e);
+                }
+                else if (expected.size() == capacity)
+                {
+                    expected.erase(order.back());
+                    order.pop_back();
+                }
+                order.push_front(key);
+                expected[key] = std::make_pair(i, order.begin());
+            }
+            else
+            {
+                int *value = cache.get(key);
+                AssertThat(value != 0, Is().EqualTo(e != expected.end()));
+                if (value)
+                {
+                    AssertThat(*value, Is().EqualTo(e->second.first));
+                    order.erase(e->second.second);
+                    order.push_front(key);
+                    e->second.second = order.begin();
+                }
+            }
+        }
+        AssertThat(cache.size(), Is().EqualTo(expected.size()));
+    });
+}
+
+void testIntervalTree()
+{
+    IntervalTree<int,int> tree;
+    std::vector<std::pair<int,int>> intervals;
+    std::default_random_engine random(7);
+    std::uniform_int_distribution<int> starts(0, 999), lengths(1, 50);
+    for (int i = 0; i < 500; ++i)
+    {
+        int start = starts(random), end = start + lengths(random);
+        if (tree.find(start, end) == tree.end())
+            intervals.push_back(std::make_pair(start, end));
+        tree.insert(start, end, start * end);
+    }
+    
+    // the intervals a brute-force scan finds, sorted as the tree reports them
+    auto scan = [&](int lo, int hi, bool inclusive)
+    {
+        std::vector<std::pair<int,int>> found;
+        for (const auto& i : intervals)
+            if (lo < i.second && (inclusive ? i.first <= hi : i.first < hi))
+                found.push_back(i);
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    auto query = [&](int lo, int hi, bool inclusive)
+    {
+        std::vector<std::pair<int,int>> found;
+        auto visitor = [&](const IntervalTree<int,int>::Entry& e)
+        {
+            AssertThat(e.second, Is().EqualTo(e.first.start * e.first.end));
+            found.push_back(std::make_pair(e.first.start, e.first.end));
+        };
+        if (inclusive)
+            tree.containing(lo, visitor);
+        else
+            tree.overlapping(lo, hi, visitor);
+        return found;
+    };
+    
+    it("Finds the intervals containing a point", [&]()
+    {
+        AssertThat(tree.size(), Is().EqualTo(intervals.size()));
+        for (int x = -1; x < 1100; x += 7)
+            AssertThat(query(x, x, true), Is().EqualTo(scan(x, x, true)));
+    });
+    
+    it("Finds the intervals overlapping an interval", [&]()
+    {
+        for (int lo = -10; lo < 1100; lo += 13)
+        {
+            for (int length : { 1, 5, 40, 300 })
+                AssertThat(query(lo, lo + length, false), Is().EqualTo(scan(lo, lo + length, false)));
+            AssertThat(query(lo, lo, false).empty(), Is().True());
+        }
+    });
+    
+    it("Keeps finding them after removals", [&]()
+    {
+        for (std::size_t i = 0; i < intervals.size(); i += 2)
+            tree.erase(intervals[i].first, intervals[i].second);
+        std::vector<std::pair<int,int>> remaining;
+        for (std::size_t i = 1; i < intervals.size(); i += 2)
+            remaining.push_back(intervals[i]);
+        intervals = remaining;
+        
+        AssertThat(tree.size(), Is().EqualTo(intervals.size()));
+        for (int x = -1; x < 1100; x += 3)
+            AssertThat(query(x, x, true), Is().EqualTo(scan(x, x, true)));
+        for (int lo = 0; lo < 1000; lo += 17)
+            AssertThat(query(lo, lo + 20, false), Is().EqualTo(scan(lo, lo + 20, false)));
+        AssertThrows(IntervalTreeNoSuchElement, tree.erase(intervals[0].first, intervals[0].second + 1000));
+    });
+    
+    it("Stays balanced with sorted intervals", [&]()
+    {
+        IntervalTree<int,int> sorted;
+        for (int i = 0; i < 1000; ++i)
+        {
+            sorted.insert(i, i + 10, i);
+            AssertThat(isAVLHeight(sorted.height(), sorted.size()), Is().True());
+        }
+        for (int i = 0; i < 1000; i += 2)
+        {
+            sorted.erase(i, i + 10);
+            AssertThat(isAVLHeight(sorted.height(), sorted.size()), Is().True());
+        }
+        AssertThat(sorted.size(), Is().EqualTo(500u));
+    });
+}
+
+void testStaticTreeMap()
+{
+    it("Freezes TreeMaps of every shape", [&]()
+    {
+        for (int size = 0; size < 70; ++size)
+        {
+            TreeMap<int,int> map;
+            std::vector<int> keys;
+            for (int i = 0; i < size; ++i)
+            {
+                map.insert(2 * i, 4 * i * i);
+                keys.push_back(2 * i);
+            }
+            StaticTreeMap<int,int> frozen(map);
+            
+            AssertThat(sameKeys(frozen, keys), Is().True());
+            for (int k = -1; k <= 2 * size; ++k)
+            {
+                auto it = frozen.lower_bound(k);
+                if (k > 2 * (size - 1))
+                    AssertThat(it == frozen.end(), Is().True());
+                else
+                    AssertThat(it.key(), Is().EqualTo(k < 0 ? 0 : k + k % 2));
+                AssertThat(frozen.find(k) == frozen.end(), Is().EqualTo(k < 0 || k % 2 != 0 || k >= 2 * size));
+            }
+            for (int k : keys)
+                AssertThat(frozen.at(k), Is().EqualTo(k * k));
+            AssertThrows(StaticTreeMapNoSuchElement, frozen.at(1));
+        }
+    });
+    
+    it("Builds from sorted ranges, and copies", [&]()
+    {
+        std::vector<std::pair<int,int>> entries;
+        for (int i = 0; i < 1000; ++i)
+            entries.push_back(std::make_pair(i, i * i));
+        auto frozen = StaticTreeMap<int,int>::from_sorted(std::begin(entries), std::end(entries));
+        StaticTreeMap<int,int> copy(frozen);
+        frozen = StaticTreeMap<int,int>();
+        
+        AssertThat(frozen.begin() == frozen.end(), Is().True());
+        AssertThat(copy.size(), Is().EqualTo(entries.size()));
+        int i = 0;
+        for (auto it = copy.begin(); it != copy.end(); it.next(), ++i)
+        {
+            AssertThat(it.elem().first, Is().EqualTo(entries[i].first));
+            AssertThat(it.elem().second, Is().EqualTo(entries[i].second));
+        }
+        AssertThat(i, Is().EqualTo(1000));
+    });
+}
+
+/**
+ * Elements of a BinTree traversal, in order
+ */
+template<typename R>
+std::vector<int> elemsIn(const R& range)
+{
+    std::vector<int> elems;
+    for (auto it = range.begin(); it != range.end(); it.next())
+        elems.push_back(it.elem());
+    return elems;
+}
+
+void testBinTreeTraversals()
+{
+    /*
+     *        1
+     *      /   \
+     *     2     3
+     *    / \     \
+     *   4   5     6
+     *      /
+     *     7
+     */
+    BinTree<int> t;
+    t._root = t.createNode(1, 
+        t.createNode(2, t.createNode(4), t.createNode(5, t.createNode(7))),
+        t.createNode(3, 0, t.createNode(6)));
+    
+    it("Walks trees lazily in every order", [&]()
+    {
+        AssertThat(elemsIn(t.preorder(t._root)), Is().EqualTo(std::vector<int>{ 1, 2, 4, 5, 7, 3, 6 }));
+        AssertThat(elemsIn(t.inorder(t._root)), Is().EqualTo(std::vector<int>{ 4, 2, 7, 5, 1, 3, 6 }));
+        AssertThat(elemsIn(t.postorder(t._root)), Is().EqualTo(std::vector<int>{ 4, 7, 5, 2, 6, 3, 1 }));
+        AssertThat(elemsIn(t.levels(t._root)), Is().EqualTo(std::vector<int>{ 1, 2, 3, 4, 5, 6, 7 }));
+    });
+    
+    it("Walks subtrees without leaving them", [&]()
+    {
+        BinTree<int>::Node* two = t._root->_left;
+        AssertThat(elemsIn(t.preorder(two)), Is().EqualTo(std::vector<int>{ 2, 4, 5, 7 }));
+        AssertThat(elemsIn(t.inorder(two)), Is().EqualTo(std::vector<int>{ 4, 2, 7, 5 }));
+        AssertThat(elemsIn(t.postorder(two)), Is().EqualTo(std::vector<int>{ 4, 7, 5, 2 }));
+        AssertThat(elemsIn(t.levels(two)), Is().EqualTo(std::vector<int>{ 2, 4, 5, 7 }));
+        AssertThat(elemsIn(t.inorder(nullptr)).empty(), Is().True());
+    });
+    
+    it("Still accumulates traversals into collections", [&]()
+    {
+        std::vector<int> pre, in, post, levels;
+        t.preorder(pre, t._root);
+        t.inorder(in, t._root);
+        t.postorder(post, t._root);
+        t.levels(levels, t._root);
+        AssertThat(pre, Is().EqualTo(elemsIn(t.preorder(t._root))));
+        AssertThat(in, Is().EqualTo(elemsIn(t.inorder(t._root))));
+        AssertThat(post, Is().EqualTo(elemsIn(t.postorder(t._root))));
+        AssertThat(levels, Is().EqualTo(elemsIn(t.levels(t._root))));
+    });
+    
+    it("Walks in-order with Morris' algorithm, restoring the tree", [&]()
+    {
+        std::vector<int> visited;
+        bool completed = BinTree<int>::morrisInorder(t._root, [&](int e) { visited.push_back(e); return true; });
+        AssertThat(completed, Is().True());
+        AssertThat(visited, Is().EqualTo(elemsIn(t.inorder(t._root))));
+        
+        visited.clear();
+        completed = BinTree<int>::morrisInorder(t._root, [&](int e) { visited.push_back(e); return visited.size() < 3; });
+        AssertThat(completed, Is().False());
+        AssertThat(visited, Is().EqualTo(std::vector<int>{ 4, 2, 7 }));
+        AssertThat(elemsIn(t.preorder(t._root)), Is().EqualTo(std::vector<int>{ 1, 2, 4, 5, 7, 3, 6 }));
+        AssertThat(elemsIn(t.inorder(t._root)), Is().EqualTo(std::vector<int>{ 4, 2, 7, 5, 1, 3, 6 }));
+    });
+    
+    it("Throws when advancing past the end", [&]()
+    {
+        auto it = t.levels(t._root->_right->_right).begin();
+        it.next();
+        AssertThrows(BinTreeInvalidAccess, it.next());
+    });
+}
+
 template<typename T , std::size_t SIZE, bool print = false, typename Allocator = std::allocator<T>>
 void testFibHeap()
 {
@@ -225,7 +1553,7 @@ void testFibHeap()
     
     it("Deletes min correctly", [&]()
     {
-        for (T i = begin; i < end; ++i)
+        for (T i = begin; i <= end; ++i)
         {
             auto min = heap.extract_min();
             if(print)
@@ -233,6 +1561,8 @@ void testFibHeap()
 
             AssertThat(min, Is().EqualTo(i));
         }
+        
+        AssertThat(heap.empty(), Is().True());
     });
     
     std::default_random_engine prng{std::random_device{}()};
@@ -306,6 +1636,138 @@ void testFibHeap()
     });
 }
 
+template<std::size_t SIZE, typename Allocator>
+void testFibHeapHandles()
+{
+    typedef FibHeap<int, std::less<int>, Allocator> Heap;
+    typedef std::pair<int, std::size_t> Entry; //(key, handle index)
+    
+    it("Decreases keys and erases like a reference", [&]()
+    {
+        Heap heap;
+        std::set<Entry> reference;
+        std::vector<typename Heap::handle> handles;
+        std::vector<bool> alive;
+        std::default_random_engine prng{42};
+        
+        //Keys are (value * STRIDE + handle index), so that no two elements tie and the
+        //reference always knows which one the heap extracted. Decreasing keeps the index
+        const int STRIDE = 20 * SIZE;
+        
+        auto any_alive = [&]() -> std::size_t
+        {
+            std::size_t i = prng() % handles.size();
+            while(!alive[i])
+                i = (i + 1) % handles.size();
+            return i;
+        };
+        
+        for(std::size_t step = 0; step < 20 * SIZE; ++step)
+        {
+            unsigned op = reference.empty() ? 0 : prng() % 4;
+            
+            if(op == 0)
+            {
+                int key = (int)(prng() % (10 * SIZE)) * STRIDE + (int)handles.size();
+                handles.push_back(heap.insert(key));
+                alive.push_back(true);
+                reference.insert(Entry(key, handles.size() - 1));
+            }
+            else if(op == 1)
+            {
+                std::size_t i = any_alive();
+                int key = handles[i].key();
+                int smaller = key - (int)(prng() % SIZE) * STRIDE;
+                heap.decrease_key(handles[i], smaller);
+                reference.erase(Entry(key, i));
+                reference.insert(Entry(smaller, i));
+                AssertThat(handles[i].key(), Is().EqualTo(smaller));
+            }
+            else if(op == 2)
+            {
+                std::size_t i = any_alive();
+                reference.erase(Entry(handles[i].key(), i));
+                heap.erase(handles[i]);
+                alive[i] = false;
+            }
+            else
+            {
+                int min = heap.extract_min();
+                AssertThat(min, Is().EqualTo(reference.begin()->first));
+                alive[reference.begin()->second] = false;
+                reference.erase(reference.begin());
+            }
+            
+            AssertThat(heap.size(), Is().EqualTo(reference.size()));
+            if(!reference.empty())
+                AssertThat(heap.min(), Is().EqualTo(reference.begin()->first));
+        }
+        
+        for(const Entry& e : reference)
+            AssertThat(heap.extract_min(), Is().EqualTo(e.first));
+        AssertThat(heap.empty(), Is().True());
+    });
+    
+    it("Keeps handles valid across consolidation", [&]()
+    {
+        Heap heap;
+        std::vector<typename Heap::handle> handles;
+        for(int i = 0; i < (int)SIZE; ++i)
+            handles.push_back(heap.insert(i + (int)SIZE));
+        
+        //Builds trees, then cuts deep nodes out of them
+        AssertThat(heap.extract_min(), Is().EqualTo((int)SIZE));
+        for(int i = (int)SIZE - 1; i > 0; i -= 2)
+            heap.decrease_key(handles[i], -i);
+        
+        for(int i = 1; i < (int)SIZE; i += 2)
+            AssertThat(heap.extract_min(), Is().EqualTo(-((int)SIZE - i)));
+        for(int i = 2; i < (int)SIZE; i += 2)
+            AssertThat(heap.extract_min(), Is().EqualTo(i + (int)SIZE));
+        AssertThat(heap.empty(), Is().True());
+    });
+}
+
+void testNodePool()
+{
+    typedef impl::node<int> Node;
+    
+    it("Recycles deallocated nodes", [&]()
+    {
+        impl::node_pool<Node> pool;
+        Node* a = pool.allocate(1);
+        Node* b = pool.allocate(1);
+        AssertThat(a != b, Is().True());
+        
+        pool.deallocate(a, 1);
+        AssertThat(pool.allocate(1) == a, Is().True());
+        pool.deallocate(b, 1);
+        pool.deallocate(a, 1);
+    });
+    
+    it("Hands out distinct nodes across chunks", [&]()
+    {
+        impl::node_pool<Node, 64> pool;
+        std::set<Node*> nodes;
+        for(int i = 0; i < 1000; ++i)
+        {
+            Node* n = pool.allocate(1);
+            pool.construct(n, i);
+            nodes.insert(n);
+        }
+        AssertThat(nodes.size(), Is().EqualTo(1000u));
+        
+        int sum = 0;
+        for(Node* n : nodes)
+        {
+            sum += n->key;
+            pool.destroy(n);
+            pool.deallocate(n, 1);
+        }
+        AssertThat(sum, Is().EqualTo(999 * 1000 / 2));
+    });
+}
+
 go_bandit([]()
 {   
     describe("Testing iterator adapters on linear containers" , []()
@@ -401,12 +1863,223 @@ go_bandit([]()
         });
     });
 
+    describe("Testing BinTree", []()
+    {
+        testBinTreeTraversals();
+        testBinTreeParallel();
+        testBinTreeDegenerate();
+    });
+    
+    describe("Testing ordered maps", []()
+    {
+        std::vector<int> sorted(1000);
+        std::iota(std::begin(sorted), std::end(sorted), 0);
+        std::vector<int> reversed(sorted.rbegin(), sorted.rend());
+        std::vector<int> shuffled(sorted);
+        std::shuffle(std::begin(shuffled), std::end(shuffled), std::default_random_engine{});
+        
+        describe("Testing TreeMap with sorted keys", [&]()
+        {
+            testOrderedMap<DefaultTreeMap,1000>(sorted);
+        });
+        
+        describe("Testing TreeMap balance with sorted keys", [&]()
+        {
+            testTreeBalance<DefaultTreeMap,1000>(sorted);
+        });
+        
+        describe("Testing TreeMap with reverse-sorted keys", [&]()
+        {
+            testOrderedMap<DefaultTreeMap,1000>(reversed);
+        });
+        
+        describe("Testing TreeMap balance with reverse-sorted keys", [&]()
+        {
+            testTreeBalance<DefaultTreeMap,1000>(reversed);
+        });
+        
+        describe("Testing TreeMap with random keys", [&]()
+        {
+            testOrderedMap<DefaultTreeMap,1000>(shuffled);
+        });
+        
+        describe("Testing TreeMap balance with random keys", [&]()
+        {
+            testTreeBalance<DefaultTreeMap,1000>(shuffled);
+        });
+        
+        describe("Testing TreeMap::Iterator", []()
+        {
+            testTreeMapIterators();
+        });
+        
+        describe("Testing TreeMap range queries", []()
+        {
+            testTreeMapRanges();
+        });
+        
+        describe("Testing TreeMap order statistics", []()
+        {
+            testTreeMapOrderStatistics();
+        });
+        
+        describe("Testing TreeMap::from_sorted", []()
+        {
+            testTreeMapFromSorted();
+        });
+        
+        describe("Testing TreeMap with other orderings", []()
+        {
+            testTreeMapCompare();
+        });
+        
+        describe("Testing TreeMap set algebra", []()
+        {
+            testTreeMapSetAlgebra();
+        });
+        
+        describe("Testing Set::H algebra", []()
+        {
+            testSetAlgebra<Set<int>::H>();
+        });
+        
+        describe("Testing Set::HF algebra", []()
+        {
+            testSetAlgebra<Set<int>::HF>();
+        });
+        
+        describe("Testing Set::T algebra", []()
+        {
+            testSetAlgebra<Set<int>::T>();
+        });
+        
+        describe("Testing set algebra on a descending TreeMap", []()
+        {
+            testSetAlgebra<BaseSet<int, DescendingTreeMap>>();
+        });
+        
+        describe("Testing Set::R algebra", []()
+        {
+            testSetAlgebra<Set<int>::R>();
+        });
+        
+        describe("Testing SplayTreeMap with sorted keys", [&]()
+        {
+            testOrderedMap<SplayTreeMap,1000>(sorted);
+        });
+        
+        describe("Testing SplayTreeMap with random keys", [&]()
+        {
+            testOrderedMap<SplayTreeMap,1000>(shuffled);
+        });
+        
+        describe("Testing SplayTreeMap", []()
+        {
+            testSplayTreeMap();
+        });
+        
+        describe("Testing Map::MH", []()
+        {
+            testMultiMap<Map<int,int>::MH>(false);
+        });
+        
+        describe("Testing Map::MT", []()
+        {
+            testMultiMap<Map<int,int>::MT>(true);
+        });
+        
+        describe("Testing Set::MH", []()
+        {
+            testMultiSet<Set<int>::MH>();
+        });
+        
+        describe("Testing Set::MT", []()
+        {
+            testMultiSet<Set<int>::MT>();
+        });
+        
+        describe("Testing ConcurrentSkipListMap with random keys", [&]()
+        {
+            testOrderedMap<ConcurrentSkipListMap,1000>(shuffled);
+        });
+        
+        describe("Testing ConcurrentSkipListMap", []()
+        {
+            testConcurrentSkipListMap();
+        });
+        
+        describe("Testing PersistentTreeMap with random keys", [&]()
+        {
+            testOrderedMap<PersistentTreeMap,1000>(shuffled);
+        });
+        
+        describe("Testing PersistentTreeMap balance with sorted keys", [&]()
+        {
+            testTreeBalance<PersistentTreeMap,1000>(sorted);
+        });
+        
+        describe("Testing PersistentTreeMap", []()
+        {
+            testPersistentTreeMap();
+        });
+        
+        describe("Testing Cache", []()
+        {
+            testCache();
+        });
+        
+        describe("Testing IntervalTree", []()
+        {
+            testIntervalTree();
+        });
+        
+        describe("Testing BlockedBloomFilter", []()
+        {
+            testBloomFilter();
+        });
+        
+        describe("Testing RoaringBitmap", []()
+        {
+            testRoaringBitmap();
+        });
+        
+        describe("Testing StaticTreeMap", []()
+        {
+            testStaticTreeMap();
+        });
+        
+        describe("Testing BPlusTreeMap with sorted keys", [&]()
+        {
+            testOrderedMap<DefaultBPlusTreeMap,1000>(sorted);
+        });
+        
+        describe("Testing BPlusTreeMap with random keys", [&]()
+        {
+            testOrderedMap<DefaultBPlusTreeMap,1000>(shuffled);
+        });
+    });
+
 	describe("Testing Fibheap", []()
 	{
-		describe("Testing FibHeap<int,std::allocator>", []()
+		describe("Testing FibHeap<int,impl::node_pool>", []()
 		{
                     testFibHeap<int, 50, true>();
 		});
+
+		describe("Testing FibHeap handles", []()
+		{
+                    testFibHeapHandles<50, impl::node_pool<impl::node<int>>>();
+		});
+
+		describe("Testing FibHeap handles with std::allocator", []()
+		{
+                    testFibHeapHandles<50, std::allocator<impl::node<int>>>();
+		});
+
+		describe("Testing impl::node_pool", []()
+		{
+                    testNodePool();
+		});
 	});
 });
 